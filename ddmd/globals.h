@@ -217,6 +217,8 @@ struct Param
     bool disableRedZone;
 
     uint32_t hashThreshold; // MD5 hash symbols larger than this threshold (0 = no hashing)
+
+    bool hashSourceFiles; // Keep MD5 hashes of module sources (for the ir2obj cache)
 #endif
 };
 
@@ -243,6 +245,7 @@ struct Global
     const char *llvm_version;
 
     bool gaggedForInlining; // Set for functionSemantic3 for external inlining candidates
+    bool usedDateTimeTokens; // Set when __DATE__, __TIME__ or __TIMESTAMP__ has been lexed
 #endif
     const char *lib_ext;
     const char *dll_ext;
@@ -186,6 +186,10 @@ public:
     bool llvmForceLogging;
     bool noModuleInfo; /// Do not emit any module metadata.
 
+    /// MD5 hash of the source file, updated with the contents of string
+    /// imports. Only set with global.params.hashSourceFiles.
+    unsigned char srcHash[16];
+
     // array ops emitted in this module already
     AA *arrayfuncs;
 
@@ -37,6 +37,11 @@ struct File
 
     const char *toChars();
 
+    /* Release a buffer mapped by read()
+     */
+
+    void unmap();
+
     /* Read file, return true if error
      */
 
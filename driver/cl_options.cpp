@@ -46,6 +46,8 @@ struct CoverageParser : public cl::parser<unsigned char> {
   }
 };
 
+std::vector<std::string> allArguments;
+
 // Positional options first, in order:
 cl::list<std::string> fileList(cl::Positional, cl::desc("files"));
 
@@ -116,6 +118,9 @@ static cl::opt<ubyte, true>
     debugInfo(cl::desc("Generating debug information:"), cl::ZeroOrMore,
               cl::values(clEnumValN(1, "g", "Generate debug information"),
                          clEnumValN(2, "gc", "Same as -g, but pretend to be C"),
+                         clEnumValN(3, "gline-tables-only",
+                                    "Generate line-tables-only debug "
+                                    "information (e.g. for sample profiles)"),
                          clEnumValEnd),
               cl::location(global.params.symdebug), cl::init(0));
 
@@ -384,6 +389,16 @@ cl::opt<bool, true>
     singleObj("singleobj", cl::desc("Create only a single output object file"),
               cl::location(global.params.oneobj));
 
+cl::opt<unsigned> threads(
+    "threads",
+    cl::desc("Optimize and emit machine code for up to <n> modules in "
+             "parallel, or split -singleobj code generation into <n> "
+             "partitions (0: one thread per CPU core)"),
+    cl::value_desc("n"), cl::init(1), cl::ZeroOrMore);
+
+static cl::alias threadsAlias("j", cl::desc("Alias for -threads"),
+                              cl::aliasopt(threads));
+
 cl::opt<uint32_t, true> hashThreshold(
     "hash-threshold",
     cl::desc("hash symbol names longer than this threshold (experimental)"),
@@ -400,6 +415,24 @@ cl::opt<bool> disableLinkerStripDead(
     cl::desc("Do not try to remove unused symbols during linking"),
     cl::init(false));
 
+cl::opt<LTOKind> ltoMode(
+    "flto", cl::desc("Emit LLVM bitcode objects for link-time optimization"),
+    cl::ZeroOrMore, cl::ValueOptional, cl::init(LTO_None),
+    cl::values(clEnumValN(LTO_Full, "", "Same as -flto=full"),
+               clEnumValN(LTO_Full, "full",
+                          "Merge all input into a single module at link time"),
+#if LDC_LLVM_VER >= 309
+               clEnumValN(LTO_Thin, "thin",
+                          "Parallel importing and codegen at link time"),
+#endif
+               clEnumValEnd));
+
+cl::opt<std::string>
+    ltoPlugin("flto-binary",
+              cl::desc("Use <file> as the linker's LTO plugin (default: "
+                       "LLVMgold.so next to LDC or LLVM)"),
+              cl::value_desc("file"), cl::ZeroOrMore);
+
 cl::opt<bool, true>
     allinst("allinst",
             cl::desc("generate code for all template instantiations"),
@@ -433,6 +466,23 @@ cl::opt<unsigned char, true, CoverageParser> coverageAnalysis(
                     "minimum required coverage)"),
     cl::location(global.params.covPercent), cl::ValueOptional, cl::init(127));
 
+cl::opt<CoverageIncrement> coverageIncrement(
+    "cov-increment", cl::ZeroOrMore,
+    cl::desc("Set the way code coverage line counts are incremented"),
+    cl::init(CoverageIncrement::atomic),
+    cl::values(
+        clEnumValN(CoverageIncrement::atomic, "atomic",
+                   "Atomic increment (default)"),
+        clEnumValN(CoverageIncrement::nonAtomic, "non-atomic",
+                   "Non-atomic increment (not thread safe)"),
+        clEnumValN(CoverageIncrement::boolean, "boolean",
+                   "Only record whether a line was executed, by setting its "
+                   "count to 1 once per basic block"),
+        clEnumValN(CoverageIncrement::threadLocal, "tls",
+                   "Count in thread-local arrays, which are added to the "
+                   "module's counts when a thread exits"),
+        clEnumValEnd));
+
 #if LDC_WITH_PGO
 cl::opt<std::string>
     genfileInstrProf("fprofile-instr-generate", cl::value_desc("filename"),
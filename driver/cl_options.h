@@ -70,9 +70,18 @@ extern cl::opt<llvm::CodeModel::Model> mCodeModel;
 extern cl::opt<bool> disableFpElim;
 extern cl::opt<FloatABI::Type> mFloatABI;
 extern cl::opt<bool, true> singleObj;
+extern cl::opt<unsigned> threads;
 extern cl::opt<bool> linkonceTemplates;
 extern cl::opt<bool> disableLinkerStripDead;
 
+enum LTOKind { LTO_None, LTO_Full, LTO_Thin };
+extern cl::opt<LTOKind> ltoMode;
+extern cl::opt<std::string> ltoPlugin;
+inline bool isUsingLTO() { return ltoMode != LTO_None; }
+
+enum class CoverageIncrement { atomic, nonAtomic, boolean, threadLocal };
+extern cl::opt<CoverageIncrement> coverageIncrement;
+
 extern cl::opt<BOUNDSCHECK> boundsCheck;
 extern bool nonSafeBoundsChecks;
 
@@ -83,6 +92,9 @@ extern cl::opt<std::string> genfileInstrProf;
 extern cl::opt<std::string> usefileInstrProf;
 #endif
 
+// The full command line, including the switches from the config file
+extern std::vector<std::string> allArguments;
+
 // Arguments to -d-debug
 extern std::vector<std::string> debugArgs;
 // Arguments to -run
@@ -13,11 +13,14 @@
 #include "mars.h"
 #include "module.h"
 #include "scope.h"
+#include "driver/ir2obj_cache.h"
 #include "driver/linker.h"
+#include "driver/timetrace.h"
 #include "driver/toobj.h"
 #include "gen/logger.h"
 #include "gen/modules.h"
 #include "gen/runtime.h"
+#include "llvm/ADT/SmallString.h"
 
 /// The module with the frontend-generated C main() definition.
 extern Module *g_entrypointModule;
@@ -180,10 +183,32 @@ void CodeGenerator::writeAndFreeLLModule(const char *filename) {
       {llvm::MDString::get(ir_->context(), Version)};
   IdentMetadata->addOperand(llvm::MDNode::get(ir_->context(), IdentNode));
 
-  writeModule(&ir_->module, filename);
+  writeModule(&ir_->module, filename, sourceHash_);
   global.params.objfiles->push(const_cast<char *>(filename));
   delete ir_;
   ir_ = nullptr;
+  sourceHash_.clear();
+}
+
+bool CodeGenerator::recoverCachedObjectFile(Module *m) {
+  llvm::SmallString<32> hash;
+  if (singleObj_ || !ir2obj::calculateModuleSourceHash(m, hash)) {
+    ir2obj::addWarmStartObject("", "");
+    return false;
+  }
+
+  m->deleteObjFile();
+  const char *filename = m->objfile->name->str;
+  ir2obj::addWarmStartObject(filename, hash);
+  if (ir2obj::cacheLookup(hash).empty() ||
+      !ir2obj::recoverObjectFile(hash, filename)) {
+    // Register the object file under this key once it has been written.
+    sourceHash_ = hash.str();
+    return false;
+  }
+
+  global.params.objfiles->push(const_cast<char *>(filename));
+  return true;
 }
 
 namespace {
@@ -212,6 +237,9 @@ void CodeGenerator::emit(Module *m) {
   IF_LOG Logger::println("CodeGenerator::emit(%s)", m->toPrettyChars());
   LOG_SCOPE;
 
+  TimeTraceScope timeScope("Codegen module",
+                           [m] { return std::string(m->toChars()); });
+
   if (global.params.verbose_cg) {
     printf("codegen: %s (%s)\n", m->toPrettyChars(), m->srcfile->toChars());
   }
@@ -221,6 +249,14 @@ void CodeGenerator::emit(Module *m) {
     fatal();
   }
 
+  // Skip IR generation altogether if the sources haven't changed.
+  if (recoverCachedObjectFile(m)) {
+    if (m->llvmForceLogging && !loggerWasEnabled) {
+      Logger::disable();
+    }
+    return;
+  }
+
   prepareLLModule(m);
 
   codegenModule(ir_, m);
@@ -34,12 +34,16 @@ private:
   void prepareLLModule(Module *m);
   void finishLLModule(Module *m);
   void writeAndFreeLLModule(const char *filename);
+  /// Tries to recover the module's object file from the IR-to-object cache
+  /// without generating any IR (see ir2obj::calculateModuleSourceHash).
+  bool recoverCachedObjectFile(Module *m);
 
   llvm::LLVMContext &context_;
   int moduleCount_;
   bool const singleObj_;
   IRState *ir_;
   const char *firstModuleObjfileName_;
+  std::string sourceHash_;
 };
 }
 
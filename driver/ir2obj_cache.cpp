@@ -18,37 +18,75 @@
 // changes that trigger recompilation of many files but with little effective
 // changes (in the extreme case, adding a comment in a "globals.d").
 //
-// The current limitation is that hashing and cache look-up are done with
-// whole-module granularity. Future work could attempt to do this for module
-// "fragments".
+// Hashing and cache look-up are done with whole-module granularity. With
+// -ir2obj-cache-partitions, modules that miss the cache are additionally split
+// into function-level partitions (see toobj.cpp), which are looked up and
+// cached individually, so that a small change to a big module only requires
+// emitting the affected partitions again.
 //
 // The hash depends on the IR code (obviously), but also on the compiler+LLVM
 // versions and several compile flags (e.g. -O*, -mcpu, and -mattr).
 //
+// Computing that hash requires generating the module's IR first. To skip IR
+// generation altogether for unchanged modules, a second-level key is derived
+// from the inputs of the whole compilation before codegen: the full command
+// line, the sources of all loaded modules (incl. string imports) and the PGO
+// profile data. Cached objects are additionally registered under that key.
+//
+// With -ir2obj-cache-warm-start, the frontend can be skipped as well: each
+// compilation whose object files can all be recovered via their source keys is
+// recorded under a key of the compiler and its command line, together with the
+// hashes of all files it has read. A later compilation with the same command
+// line recovers all object files right away if none of these files have
+// changed. This is similar to the direct mode of ccache and has the same
+// limitations: a new file that would be found first on the import path is not
+// noticed, and messages that don't fail the compilation (e.g. pragma(msg),
+// informational warnings and deprecations) are not repeated.
+//
 //===----------------------------------------------------------------------===//
 
 #include "driver/ir2obj_cache.h"
 
 #include "ddmd/errors.h"
+#include "module.h"
 #include "driver/cl_options.h"
 #include "driver/ldc-version.h"
 #include "driver/ir2obj_cache_pruning.h"
+#include "driver/toobj.h"
 #include "gen/logger.h"
 #include "gen/optimizer.h"
 
 #include "llvm/Bitcode/ReaderWriter.h"
+#include "llvm/Support/Endian.h"
 #include "llvm/Support/FileSystem.h"
 #include "llvm/Support/MD5.h"
+#include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/Path.h"
 #include "llvm/Support/raw_ostream.h"
 
-// Include close() declaration.
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+#include <system_error>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+// Include close() and link() declarations.
 #if !defined(_MSC_VER) && !defined(__MINGW32__)
 #include <unistd.h>
 #else
 #include <io.h>
 #endif
 
+// FICLONE (reflink) ioctl.
+#if defined(__linux__)
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#endif
+
 namespace {
 
 // Options for the cache pruning algorithm
@@ -79,6 +117,20 @@ llvm::cl::opt<unsigned> pruneSizeLimitPercentage(
         "space (default: 75%). Implies -ir2obj-cache-prune."),
     llvm::cl::value_desc("perc"), llvm::cl::init(75));
 
+llvm::cl::opt<bool> warmStart(
+    "ir2obj-cache-warm-start",
+    llvm::cl::desc("Record the files read by each compilation, and recover "
+                   "all object files of a compilation with the same command "
+                   "line from the cache before reading any source file if "
+                   "none of these files have changed (experimental)"),
+    llvm::cl::ZeroOrMore);
+
+llvm::cl::opt<unsigned> cachePartitions(
+    "ir2obj-cache-partitions",
+    llvm::cl::desc("Split each module into <n> partitions for machine code "
+                   "generation, which are cached individually (experimental)"),
+    llvm::cl::value_desc("n"), llvm::cl::init(0));
+
 bool isPruningEnabled() {
   if (pruneEnabled)
     return true;
@@ -93,11 +145,113 @@ bool isPruningEnabled() {
   return false;
 }
 
+void toHexString(llvm::ArrayRef<uint8_t> bytes, llvm::SmallString<32> &str) {
+  static const char hexDigits[] = "0123456789abcdef";
+  str.clear();
+  for (uint8_t byte : bytes) {
+    str.push_back(hexDigits[byte >> 4]);
+    str.push_back(hexDigits[byte & 15]);
+  }
+}
+
+/// Streaming implementation of the 128-bit x64 variant of MurmurHash3 (by
+/// Austin Appleby, public domain). It is several times faster than MD5, which
+/// matters as the complete bitcode of each module is hashed. The result is
+/// independent of the host's endianness.
+class MurmurHash3 {
+  static const uint64_t c1 = 0x87c37b91114253d5ULL;
+  static const uint64_t c2 = 0x4cf5ad432745937fULL;
+
+  uint64_t h1 = 0;
+  uint64_t h2 = 0;
+  uint64_t totalSize = 0;
+  uint8_t tail[16];
+  size_t tailSize = 0;
+
+  static uint64_t rotl(uint64_t x, int r) { return (x << r) | (x >> (64 - r)); }
+
+  static uint64_t fmix(uint64_t k) {
+    k ^= k >> 33;
+    k *= 0xff51afd7ed558ccdULL;
+    k ^= k >> 33;
+    k *= 0xc4ceb9fe1a85ec53ULL;
+    k ^= k >> 33;
+    return k;
+  }
+
+  static uint64_t mixK1(uint64_t k1) { return rotl(k1 * c1, 31) * c2; }
+  static uint64_t mixK2(uint64_t k2) { return rotl(k2 * c2, 33) * c1; }
+
+  void processBlock(const uint8_t *block) {
+    using namespace llvm::support::endian;
+    h1 ^= mixK1(read64le(block));
+    h1 = rotl(h1, 27) + h2;
+    h1 = h1 * 5 + 0x52dce729;
+    h2 ^= mixK2(read64le(block + 8));
+    h2 = rotl(h2, 31) + h1;
+    h2 = h2 * 5 + 0x38495ab5;
+  }
+
+public:
+  void update(llvm::ArrayRef<uint8_t> data) {
+    const uint8_t *ptr = data.data();
+    size_t size = data.size();
+    totalSize += size;
+
+    if (tailSize > 0) {
+      size_t n = std::min(size, sizeof(tail) - tailSize);
+      memcpy(tail + tailSize, ptr, n);
+      tailSize += n;
+      ptr += n;
+      size -= n;
+      if (tailSize < sizeof(tail))
+        return;
+      processBlock(tail);
+      tailSize = 0;
+    }
+
+    for (; size >= sizeof(tail); ptr += sizeof(tail), size -= sizeof(tail)) {
+      processBlock(ptr);
+    }
+
+    memcpy(tail, ptr, size);
+    tailSize = size;
+  }
+
+  void final(uint8_t (&result)[16]) {
+    uint64_t k1 = 0, k2 = 0;
+    for (size_t i = tailSize; i > 8; --i) {
+      k2 ^= uint64_t(tail[i - 1]) << ((i - 9) * 8);
+    }
+    for (size_t i = std::min<size_t>(tailSize, 8); i > 0; --i) {
+      k1 ^= uint64_t(tail[i - 1]) << ((i - 1) * 8);
+    }
+    if (tailSize > 8) {
+      h2 ^= mixK2(k2);
+    }
+    if (tailSize > 0) {
+      h1 ^= mixK1(k1);
+    }
+
+    h1 ^= totalSize;
+    h2 ^= totalSize;
+    h1 += h2;
+    h2 += h1;
+    h1 = fmix(h1);
+    h2 = fmix(h2);
+    h1 += h2;
+    h2 += h1;
+
+    llvm::support::endian::write64le(result, h1);
+    llvm::support::endian::write64le(result + 8, h2);
+  }
+};
+
 /// A raw_ostream that creates a hash of what is written to it.
 /// This class does not encounter output errors.
 /// There is no buffering and the hasher can be used at any time.
 class raw_hash_ostream : public llvm::raw_ostream {
-  llvm::MD5 hasher;
+  MurmurHash3 hasher;
 
   /// See raw_ostream::write_impl.
   void write_impl(const char *ptr, size_t size) override {
@@ -113,27 +267,16 @@ public:
 
   void flush() = delete;
 
-  void finalResult(llvm::MD5::MD5Result &result) { hasher.final(result); }
   void resultAsString(llvm::SmallString<32> &str) {
-    llvm::MD5::MD5Result result;
+    uint8_t result[16];
     hasher.final(result);
-    llvm::MD5::stringifyResult(result, str);
+    toHexString(result, str);
   }
 };
 
-void storeCacheFileName(llvm::StringRef cacheObjectHash,
-                        llvm::SmallString<128> &filePath) {
-  filePath = opts::ir2objCacheDir;
-  llvm::sys::path::append(filePath, llvm::Twine("ircache_") + cacheObjectHash +
-                                        "." + global.obj_ext);
-}
-}
-
-namespace ir2obj {
-
-void calculateModuleHash(llvm::Module *m, llvm::SmallString<32> &str) {
-  raw_hash_ostream hash_os;
-
+/// Adds the compiler version and a few compile flags that change the outputted
+/// obj file, but whose changes are not always observable in the IR.
+void hashCompilerAndFlags(llvm::raw_ostream &hash_os) {
   // Let hash depend on the compiler version:
   hash_os << global.ldc_version << global.version << global.llvm_version
           << ldc::built_with_Dcompiler_version;
@@ -149,12 +292,282 @@ void calculateModuleHash(llvm::Module *m, llvm::SmallString<32> &str) {
   hash_os << opts::mRelocModel;
   hash_os << opts::mCodeModel;
   hash_os << opts::disableFpElim;
+  // LTO bitcode objects and native objects may have the same IR.
+  hash_os << static_cast<int>(opts::ltoMode);
+}
+
+/// Adds the command line and the working directory, which determine the files
+/// read by the compilation.
+void hashCommandLine(llvm::raw_ostream &hash_os) {
+  // The command line includes the config file switches and all root modules.
+  for (auto &arg : opts::allArguments) {
+    hash_os << arg << '\0';
+  }
+
+  // Relative paths are resolved against the working directory, which also
+  // ends up in the debug info (DW_AT_comp_dir).
+  llvm::SmallString<128> cwd;
+  if (!llvm::sys::fs::current_path(cwd)) {
+    hash_os << cwd << '\0';
+  }
+}
+
+/// Hashes everything the frontend has read for this compilation. The result is
+/// the same for all modules, so it is only computed once.
+llvm::StringRef getCompilationInputsHash() {
+  static llvm::SmallString<32> result;
+  if (!result.empty())
+    return result;
+
+  raw_hash_ostream hash_os;
+  hashCompilerAndFlags(hash_os);
+  hashCommandLine(hash_os);
+
+  for (Module *m : Module::amodules) {
+    hash_os << m->srcfile->toChars() << '\0';
+    hash_os.write(reinterpret_cast<const char *>(m->srcHash),
+                  sizeof(m->srcHash));
+  }
+
+  if (global.params.datafileInstrProf && !global.params.genInstrProf) {
+    auto buffer = llvm::MemoryBuffer::getFile(global.params.datafileInstrProf);
+    if (buffer) {
+      hash_os << (*buffer)->getBuffer();
+    }
+  }
+
+  hash_os.resultAsString(result);
+  return result;
+}
+
+void storeCacheFileName(llvm::StringRef cacheObjectHash,
+                        llvm::SmallString<128> &filePath) {
+  filePath = opts::ir2objCacheDir;
+  llvm::sys::path::append(filePath, llvm::Twine("ircache_") + cacheObjectHash +
+                                        "." + global.obj_ext);
+}
+
+// Cache statistics, reported with -v. The cache may be used by several backend
+// threads.
+std::atomic<unsigned> cacheHits(0);
+std::atomic<unsigned> cacheMisses(0);
+std::atomic<uint64_t> cacheBytesRecovered(0);
+
+bool createCacheDirectory() {
+  if (!llvm::sys::fs::exists(opts::ir2objCacheDir) &&
+      llvm::sys::fs::create_directories(opts::ir2objCacheDir)) {
+    return backendError("Unable to create cache directory: %s",
+                        opts::ir2objCacheDir.c_str());
+  }
+  return true;
+}
+
+/// Creates a hard link `to` referring to the existing file `from`.
+std::error_code createHardLink(const llvm::Twine &from, const llvm::Twine &to) {
+#if defined(_WIN32)
+  // LLVM creates hard links on Windows.
+  return llvm::sys::fs::create_link(from, to);
+#else
+  llvm::SmallString<128> fromStorage, toStorage;
+  if (::link(from.toNullTerminatedStringRef(fromStorage).data(),
+             to.toNullTerminatedStringRef(toStorage).data()) != 0) {
+    return std::error_code(errno, std::generic_category());
+  }
+  return std::error_code();
+#endif
+}
+
+/// Copies `from` to `to`, sharing the data blocks if the file system supports
+/// it (reflink, e.g. btrfs or XFS on Linux).
+std::error_code cloneOrCopyFile(const llvm::Twine &from, const llvm::Twine &to) {
+#if defined(__linux__) && defined(FICLONE)
+  int fromFD, toFD;
+  if (!llvm::sys::fs::openFileForRead(from, fromFD)) {
+    if (!llvm::sys::fs::openFileForWrite(to, toFD, llvm::sys::fs::F_None)) {
+      bool const cloned = ioctl(toFD, FICLONE, fromFD) == 0;
+      close(toFD);
+      close(fromFD);
+      if (cloned)
+        return std::error_code();
+    } else {
+      close(fromFD);
+    }
+  }
+#endif
+  return llvm::sys::fs::copy_file(from, to);
+}
+
+/// Atomically publishes `from` as the cache file `to`: the data is first
+/// linked or copied to a unique temporary file in the cache directory, which
+/// is then renamed. Concurrent compiler processes publishing the same entry
+/// therefore never observe (or produce) a partially written cache file.
+/// Returns false on failure, e.g. if `from` has been pruned concurrently.
+bool publishCacheFile(llvm::StringRef from, llvm::StringRef to,
+                      bool allowLink) {
+  llvm::SmallString<128> tempFile;
+  int tempFD;
+  if (llvm::sys::fs::createUniqueFile(to + ".tmp-%%%%%%%%", tempFD, tempFile)) {
+    IF_LOG Logger::println("Failed to create temporary file in cache "
+                           "directory: %s",
+                           opts::ir2objCacheDir.c_str());
+    return false;
+  }
+  close(tempFD);
+
+  std::error_code ec;
+  if (allowLink) {
+    llvm::sys::fs::remove(tempFile);
+    ec = createHardLink(from, tempFile);
+    if (ec) {
+      ec = cloneOrCopyFile(from, tempFile);
+    }
+  } else {
+    ec = cloneOrCopyFile(from, tempFile);
+  }
+
+  if (!ec) {
+    ec = llvm::sys::fs::rename(tempFile, to);
+  }
+
+  if (ec) {
+    llvm::sys::fs::remove(tempFile);
+    IF_LOG Logger::println("Failed to publish cache file: %s to %s",
+                           from.str().c_str(), to.str().c_str());
+    return false;
+  }
+  return true;
+}
+
+/// Appends a record for the given cache file to the cache index, which is
+/// used by the pruning algorithm instead of stat'ing all cache files (see
+/// ir2obj_cache_pruning.d). Each record is appended with a single write, so
+/// that records of concurrent compiler processes don't interleave.
+/// The record includes the file ID, so that the pruner counts the data of
+/// cache aliases (hard links to another cache file) only once.
+void appendIndexRecord(llvm::StringRef cacheFile,
+                       const llvm::sys::fs::file_status &status) {
+  llvm::SmallString<128> indexFile(opts::ir2objCacheDir);
+  llvm::sys::path::append(indexFile, "ircache_index");
+
+  // The index is only compacted by the pruning. Without pruning, remove it
+  // rather than letting it grow without bound; the next pruning run (e.g. by
+  // ldc-prune-cache) then scans the cache directory instead.
+  if (!isPruningEnabled()) {
+    static bool const removed = !llvm::sys::fs::remove(indexFile);
+    (void)removed;
+    return;
+  }
+
+  std::string record;
+  llvm::raw_string_ostream os(record);
+  os << static_cast<long long>(std::time(nullptr)) << ' ' << status.getSize()
+     << ' ' << llvm::sys::path::filename(cacheFile) << ' '
+     << status.getUniqueID().getFile() << '\n';
+  os.flush();
+
+  int FD;
+  if (llvm::sys::fs::openFileForWrite(indexFile, FD, llvm::sys::fs::F_Append)) {
+    IF_LOG Logger::println("Failed to open the cache index: %s",
+                           indexFile.c_str());
+    return;
+  }
+  llvm::raw_fd_ostream indexStream(FD, /*shouldClose=*/true,
+                                   /*unbuffered=*/true);
+  indexStream << record;
+}
+
+// Warm start: the object files and source hashes of the root modules, and
+// whether all of them can be recovered via their source hash.
+std::vector<std::pair<std::string, std::string>> warmStartObjects;
+bool warmStartRecordable = true;
+
+const char *const warmStartHeader = "ldc ir2obj warm start record v1";
+
+/// Returns whether a compilation may be recovered as a whole, i.e., whether it
+/// writes nothing but object files.
+bool isWarmStartSupported() {
+  return warmStart && !opts::ir2objCacheDir.empty() &&
+         global.params.hashSourceFiles && global.params.obj &&
+         global.params.output_o && !global.params.output_bc &&
+         !global.params.output_ll && !global.params.output_s &&
+         !global.params.oneobj && !global.params.link && !global.params.lib &&
+         !global.params.run && !global.params.doDocComments &&
+         !global.params.doHdrGeneration && !global.params.doJsonGeneration &&
+         !global.params.moduleDeps && global.params.bitcodeFiles->empty();
+}
+
+/// The warm start record is keyed by the compiler and the command line only,
+/// as it has to be found before reading any source file.
+void storeWarmStartFileName(llvm::SmallString<128> &filePath) {
+  raw_hash_ostream hash_os;
+  hash_os << "warmstart";
+  hashCompilerAndFlags(hash_os);
+  hashCommandLine(hash_os);
+
+  llvm::SmallString<32> hash;
+  hash_os.resultAsString(hash);
+
+  filePath = opts::ir2objCacheDir;
+  llvm::sys::path::append(filePath, llvm::Twine("ircache_") + hash + ".warm");
+}
+
+/// Stores the MD5 hash of the given file's contents as hex string, like
+/// Module::srcHash. Returns false if the file cannot be read.
+bool hashFile(const llvm::Twine &path, llvm::SmallString<32> &str) {
+  auto buffer = llvm::MemoryBuffer::getFile(path);
+  if (!buffer)
+    return false;
+
+  llvm::MD5 md5;
+  md5.update((*buffer)->getBuffer());
+  llvm::MD5::MD5Result result;
+  md5.final(result);
+  llvm::MD5::stringifyResult(result, str);
+  return true;
+}
+}
+
+namespace ir2obj {
+
+void calculateModuleHash(llvm::Module *m, llvm::SmallString<32> &str) {
+  raw_hash_ostream hash_os;
+  hashCompilerAndFlags(hash_os);
 
   llvm::WriteBitcodeToFile(m, hash_os);
   hash_os.resultAsString(str);
   IF_LOG Logger::println("Module's LLVM bitcode hash is: %s", str.c_str());
 }
 
+void calculateBitcodeHash(llvm::StringRef bitcode,
+                          llvm::SmallString<32> &str) {
+  raw_hash_ostream hash_os;
+  hashCompilerAndFlags(hash_os);
+
+  hash_os << bitcode;
+  hash_os.resultAsString(str);
+  IF_LOG Logger::println("Module's LLVM bitcode hash is: %s", str.c_str());
+}
+
+bool calculateModuleSourceHash(Module *m, llvm::SmallString<32> &str) {
+  // Only plain object file output is supported. Bitcode files passed on the
+  // commandline and __DATE__ & co. are not covered by the source hashes.
+  // Cross-module inlining may load further modules during codegen.
+  if (opts::ir2objCacheDir.empty() || !global.params.hashSourceFiles ||
+      global.params.oneobj || !global.params.output_o ||
+      global.params.output_bc || global.params.output_ll ||
+      global.params.output_s || !global.params.bitcodeFiles->empty() ||
+      global.usedDateTimeTokens || willCrossModuleInline()) {
+    return false;
+  }
+
+  raw_hash_ostream hash_os;
+  hash_os << "source" << getCompilationInputsHash();
+  hash_os << m->srcfile->toChars();
+  hash_os.resultAsString(str);
+  IF_LOG Logger::println("Module's source hash is: %s", str.c_str());
+  return true;
+}
+
 std::string cacheLookup(llvm::StringRef cacheObjectHash) {
   if (opts::ir2objCacheDir.empty())
     return "";
@@ -175,69 +588,273 @@ std::string cacheLookup(llvm::StringRef cacheObjectHash) {
   return "";
 }
 
-void cacheObjectFile(llvm::StringRef objectFile,
+bool cacheObjectFile(llvm::StringRef objectFile,
                      llvm::StringRef cacheObjectHash) {
   if (opts::ir2objCacheDir.empty())
-    return;
+    return true;
 
-  if (!llvm::sys::fs::exists(opts::ir2objCacheDir) &&
-      llvm::sys::fs::create_directory(opts::ir2objCacheDir)) {
-    error(Loc(), "Unable to create cache directory: %s",
-          opts::ir2objCacheDir.c_str());
-    fatal();
-  }
+  if (!createCacheDirectory())
+    return false;
 
   llvm::SmallString<128> cacheFile;
   storeCacheFileName(cacheObjectHash, cacheFile);
 
   IF_LOG Logger::println("Copy object file to cache: %s to %s",
                          objectFile.str().c_str(), cacheFile.c_str());
-  if (llvm::sys::fs::copy_file(objectFile, cacheFile.c_str())) {
-    error(Loc(), "Failed to copy object file to cache: %s to %s",
-          objectFile.str().c_str(), cacheFile.c_str());
-    fatal();
+  // The output file may be modified later (e.g. by strip), so it is copied
+  // rather than linked into the cache.
+  if (!publishCacheFile(objectFile, cacheFile, /*allowLink=*/false)) {
+    return backendError("Failed to copy object file to cache: %s to %s",
+                        objectFile.str().c_str(), cacheFile.c_str());
+  }
+  ++cacheMisses;
+
+  llvm::sys::fs::file_status status;
+  if (!llvm::sys::fs::status(cacheFile, status)) {
+    appendIndexRecord(cacheFile, status);
   }
+  return true;
 }
 
-void recoverObjectFile(llvm::StringRef cacheObjectHash,
-                       llvm::StringRef objectFile) {
-  llvm::SmallString<128> cacheFile;
-  storeCacheFileName(cacheObjectHash, cacheFile);
+void addCacheAlias(llvm::StringRef cacheObjectHash, llvm::StringRef aliasHash) {
+  if (opts::ir2objCacheDir.empty())
+    return;
 
-  // Remove the potentially pre-existing output file.
-  llvm::sys::fs::remove(objectFile);
+  llvm::SmallString<128> cacheFile, aliasFile;
+  storeCacheFileName(cacheObjectHash, cacheFile);
+  storeCacheFileName(aliasHash, aliasFile);
+
+  IF_LOG Logger::println("Add cache alias: %s -> %s", aliasFile.c_str(),
+                         cacheFile.c_str());
+  // The alias is only an optimization, so don't fail if the entry has been
+  // pruned concurrently in the meantime.
+  if (!publishCacheFile(cacheFile, aliasFile, /*allowLink=*/true)) {
+    IF_LOG Logger::println("Failed to add cache alias, skipping.");
+    return;
+  }
 
-  IF_LOG Logger::println("SymLink output to cached object file: %s -> %s",
-                         objectFile.str().c_str(), cacheFile.c_str());
-  if (llvm::sys::fs::create_link(cacheFile.c_str(), objectFile)) {
-    error(Loc(), "Failed to create a symlink to the cached file: %s -> %s",
-          cacheFile.c_str(), objectFile.str().c_str());
-    fatal();
+  llvm::sys::fs::file_status status;
+  if (!llvm::sys::fs::status(aliasFile, status)) {
+    appendIndexRecord(aliasFile, status);
   }
+}
+
+bool recoverObjectFile(llvm::StringRef cacheObjectHash,
+                       llvm::StringRef objectFile) {
+  llvm::SmallString<128> cacheFile;
+  storeCacheFileName(cacheObjectHash, cacheFile);
 
   // We reset the modification time to "now" such that the pruning algorithm
   // sees that the file should be kept over older files.
   // On some systems the last accessed time is not automatically updated so set
   // it explicitly here. Because the file will really only be accessed later
   // during linking, it's not perfect but it's the best we can do.
+  // This fails if the cache file has been pruned concurrently.
   {
     int FD;
     if (llvm::sys::fs::openFileForWrite(cacheFile.c_str(), FD,
                                         llvm::sys::fs::F_Append)) {
-      error(Loc(), "Failed to open the cached file for writing: %s",
-            cacheFile.c_str());
-      fatal();
+      IF_LOG Logger::println("Failed to open the cached file for writing: %s",
+                             cacheFile.c_str());
+      return false;
     }
 
     if (llvm::sys::fs::setLastModificationAndAccessTime(
             FD, llvm::sys::TimeValue::now())) {
-      error(Loc(), "Failed to set the cached file modification time: %s",
-            cacheFile.c_str());
-      fatal();
+      close(FD);
+      return backendError("Failed to set the cached file modification time: %s",
+                          cacheFile.c_str());
     }
 
     close(FD);
   }
+
+  // Remove the potentially pre-existing output file.
+  llvm::sys::fs::remove(objectFile);
+
+  // Like in cacheObjectFile, the output must not share its data with the
+  // cache entry, as it may be modified in place later (e.g. by strip). A
+  // reflink is fine though, as it is copy-on-write.
+  IF_LOG Logger::println("Recover output from cached object file: %s -> %s",
+                         objectFile.str().c_str(), cacheFile.c_str());
+  if (cloneOrCopyFile(cacheFile, objectFile)) {
+    IF_LOG Logger::println("Failed to recover the cached object file.");
+    llvm::sys::fs::remove(objectFile);
+    return false;
+  }
+
+  ++cacheHits;
+  llvm::sys::fs::file_status status;
+  if (!llvm::sys::fs::status(cacheFile, status)) {
+    cacheBytesRecovered += status.getSize();
+    appendIndexRecord(cacheFile, status);
+  }
+  return true;
+}
+
+void printStatistics() {
+  if (opts::ir2objCacheDir.empty() || !global.params.verbose)
+    return;
+
+  fprintf(global.stdmsg, "ir2obj    %u hits, %u misses, %llu bytes recovered\n",
+          cacheHits.load(), cacheMisses.load(),
+          static_cast<unsigned long long>(cacheBytesRecovered.load()));
+}
+
+void addWarmStartObject(llvm::StringRef objectFile,
+                        llvm::StringRef sourceHash) {
+  if (sourceHash.empty()) {
+    warmStartRecordable = false;
+    return;
+  }
+  warmStartObjects.emplace_back(objectFile.str(), sourceHash.str());
+}
+
+bool recoverCompilation() {
+  if (!isWarmStartSupported())
+    return false;
+
+  llvm::SmallString<128> recordFile;
+  storeWarmStartFileName(recordFile);
+  IF_LOG Logger::println("Looking for warm start record: %s",
+                         recordFile.c_str());
+  LOG_SCOPE;
+
+  auto buffer = llvm::MemoryBuffer::getFile(recordFile);
+  if (!buffer) {
+    IF_LOG Logger::println("Warm start record not found.");
+    return false;
+  }
+
+  llvm::SmallVector<llvm::StringRef, 64> lines;
+  (*buffer)->getBuffer().split(lines, "\n", -1, /*KeepEmpty=*/false);
+  if (lines.empty() || lines[0] != warmStartHeader)
+    return false;
+
+  // Each line is either "I <MD5 hash> <input file>" or
+  // "O <source hash> <object file>". All inputs are checked and all cache
+  // entries looked up before recovering any object file.
+  std::vector<std::pair<llvm::StringRef, llvm::StringRef>> objects;
+  for (size_t i = 1; i < lines.size(); ++i) {
+    llvm::StringRef kind, hash, path;
+    std::tie(kind, path) = lines[i].split(' ');
+    std::tie(hash, path) = path.split(' ');
+    if (path.empty())
+      return false;
+
+    if (kind == "I") {
+      llvm::SmallString<32> fileHash;
+      if (!hashFile(path, fileHash) || fileHash.str() != hash) {
+        IF_LOG Logger::println("Input file has changed: %s",
+                               path.str().c_str());
+        return false;
+      }
+    } else if (kind == "O" && !cacheLookup(hash).empty()) {
+      objects.emplace_back(hash, path);
+    } else {
+      return false;
+    }
+  }
+
+  if (objects.empty())
+    return false;
+
+  for (auto &object : objects) {
+    if (!recoverObjectFile(object.first, object.second))
+      return false;
+  }
+
+  // Keep the record over older files when pruning.
+  llvm::sys::fs::file_status status;
+  if (!llvm::sys::fs::status(recordFile, status)) {
+    appendIndexRecord(recordFile, status);
+  }
+
+  if (global.params.verbose) {
+    fprintf(global.stdmsg, "ir2obj    warm start, %u object files recovered\n",
+            static_cast<unsigned>(objects.size()));
+  }
+  return true;
+}
+
+void recordCompilation() {
+  if (!isWarmStartSupported() || !warmStartRecordable ||
+      warmStartObjects.empty())
+    return;
+
+  IF_LOG Logger::println("Recording compilation for warm starts");
+  LOG_SCOPE;
+
+  std::string record;
+  llvm::raw_string_ostream os(record);
+  os << warmStartHeader << '\n';
+
+  // Only record the compilation if each module's source file still has the
+  // hash the frontend has computed from its contents. This is not the case for
+  // modules with string imports, or if a file has been changed in the meantime.
+  for (Module *m : Module::amodules) {
+    const char *path = m->srcfile->toChars();
+    llvm::SmallString<32> fileHash, srcHash;
+    toHexString(m->srcHash, srcHash);
+    if (!hashFile(path, fileHash) || fileHash.str() != srcHash.str()) {
+      IF_LOG Logger::println("Not recorded, source differs from file: %s",
+                             path);
+      return;
+    }
+    os << "I " << fileHash << ' ' << path << '\n';
+  }
+
+  if (global.params.datafileInstrProf && !global.params.genInstrProf) {
+    llvm::SmallString<32> fileHash;
+    if (!hashFile(global.params.datafileInstrProf, fileHash))
+      return;
+    os << "I " << fileHash << ' ' << global.params.datafileInstrProf << '\n';
+  }
+
+  for (auto &object : warmStartObjects) {
+    if (cacheLookup(object.second).empty()) {
+      IF_LOG Logger::println("Not recorded, object file not cached: %s",
+                             object.first.c_str());
+      return;
+    }
+    os << "O " << object.second << ' ' << object.first << '\n';
+  }
+  os.flush();
+
+  llvm::SmallString<128> recordFile, tempFile;
+  storeWarmStartFileName(recordFile);
+  int FD;
+  if (llvm::sys::fs::createUniqueFile(llvm::Twine(recordFile) + ".tmp-%%%%%%%%",
+                                      FD, tempFile)) {
+    IF_LOG Logger::println("Failed to create temporary file in cache "
+                           "directory: %s",
+                           opts::ir2objCacheDir.c_str());
+    return;
+  }
+  llvm::raw_fd_ostream recordStream(FD, /*shouldClose=*/true);
+  recordStream << record;
+  recordStream.close();
+  if (recordStream.has_error() ||
+      llvm::sys::fs::rename(tempFile, recordFile)) {
+    recordStream.clear_error();
+    llvm::sys::fs::remove(tempFile);
+    IF_LOG Logger::println("Failed to write warm start record: %s",
+                           recordFile.c_str());
+    return;
+  }
+
+  llvm::sys::fs::file_status status;
+  if (!llvm::sys::fs::status(recordFile, status)) {
+    appendIndexRecord(recordFile, status);
+  }
+}
+
+unsigned numCachePartitions() {
+#if LDC_LLVM_VER >= 309
+  if (!opts::ir2objCacheDir.empty() && cachePartitions > 1)
+    return cachePartitions;
+#endif
+  return 1;
 }
 
 void pruneCache() {
@@ -12,6 +12,8 @@
 
 #include <string>
 
+class Module;
+
 namespace llvm {
 class Module;
 class StringRef;
@@ -21,12 +23,56 @@ template <unsigned> class SmallString;
 namespace ir2obj {
 
 void calculateModuleHash(llvm::Module *m, llvm::SmallString<32> &str);
+
+/// Same as calculateModuleHash, but for a module already serialized to
+/// bitcode (to avoid writing the bitcode twice).
+void calculateBitcodeHash(llvm::StringRef bitcode, llvm::SmallString<32> &str);
+
+/// Calculates a cache key for the given D module before generating any IR,
+/// based on the sources of the whole compilation. Returns false if the
+/// current compile flags do not allow to use such a key.
+bool calculateModuleSourceHash(Module *m, llvm::SmallString<32> &str);
 std::string cacheLookup(llvm::StringRef cacheObjectHash);
-void cacheObjectFile(llvm::StringRef objectFile,
+
+/// Atomically adds a copy of the given object file to the cache. Errors are
+/// reported via backendError(); returns false on failure.
+bool cacheObjectFile(llvm::StringRef objectFile,
                      llvm::StringRef cacheObjectHash);
-void recoverObjectFile(llvm::StringRef cacheObjectHash,
+
+/// Makes an existing cache entry also available under a second hash, sharing
+/// the file data where possible. This is best-effort: nothing is done if the
+/// entry is not available (anymore).
+void addCacheAlias(llvm::StringRef cacheObjectHash, llvm::StringRef aliasHash);
+
+/// Copies the cached object file to the output path, sharing the data blocks
+/// copy-on-write where the file system supports it. Returns false if the cache
+/// entry is not available (anymore).
+bool recoverObjectFile(llvm::StringRef cacheObjectHash,
                        llvm::StringRef objectFile);
 
+/// Notes the object file of a root module and its source hash (see
+/// calculateModuleSourceHash) for the warm start record. An empty hash means
+/// that the object file cannot be recovered that way.
+void addWarmStartObject(llvm::StringRef objectFile, llvm::StringRef sourceHash);
+
+/// With -ir2obj-cache-warm-start, recovers all object files of a previous
+/// compilation with the same compiler and command line from the cache, if none
+/// of the files it has read have changed since. To be called before reading
+/// any source file; returns false if the compilation has to be done.
+bool recoverCompilation();
+
+/// With -ir2obj-cache-warm-start, adds a record of the current compilation to
+/// the cache for recoverCompilation(), after all object files have been
+/// written.
+void recordCompilation();
+
+/// Returns the number of individually cached partitions each module is split
+/// into for machine code generation (1 if modules are not split).
+unsigned numCachePartitions();
+
+/// Prints the cache hit/miss statistics if -v is given.
+void printStatistics();
+
 /// Prune the cache to avoid filling up disk space.
 ///
 /// Note: Does nothing for LLVM < 3.7.
@@ -13,7 +13,9 @@
 #include "root.h"
 #include "driver/cl_options.h"
 #include "driver/exe_path.h"
+#include "driver/timetrace.h"
 #include "driver/tool.h"
+#include "gen/irstate.h"
 #include "gen/llvm.h"
 #include "gen/logger.h"
 #include "gen/optimizer.h"
@@ -26,6 +28,8 @@
 #include "llvm/Support/Program.h"
 #include "llvm/Support/Path.h"
 #include "llvm/Support/SourceMgr.h"
+#include "llvm/Target/TargetMachine.h"
+#include <thread>
 #if _WIN32
 #include "llvm/Support/SystemUtils.h"
 #include "llvm/Support/ConvertUTF.h"
@@ -139,6 +143,78 @@ void insertBitcodeFiles(llvm::Module &M, llvm::LLVMContext &Ctx,
 
 static std::string gExePath;
 
+/// Returns the path of the LLVMgold linker plugin for -flto.
+static std::string getLTOPluginPath() {
+  if (!opts::ltoPlugin.empty()) {
+    if (llvm::sys::fs::exists(opts::ltoPlugin)) {
+      return opts::ltoPlugin;
+    }
+    error(Loc(), "LTO plugin '%s' (-flto-binary) not found",
+          opts::ltoPlugin.c_str());
+    fatal();
+  }
+
+#define STR(x) #x
+#define XSTR(x) STR(x)
+  // Look next to LDC first, then in the LLVM installation LDC was built with.
+  const std::string searchPaths[] = {
+      exe_path::getBaseDir() + "/lib/LLVMgold.so",
+      std::string(XSTR(LDC_LLVM_LIBDIR)) + "/LLVMgold.so"};
+#undef XSTR
+#undef STR
+  for (const auto &path : searchPaths) {
+    if (llvm::sys::fs::exists(path)) {
+      return path;
+    }
+  }
+
+  error(Loc(), "cannot find the LLVMgold.so linker plugin required for -flto, "
+               "specify it with -flto-binary=<file>");
+  fatal();
+  return "";
+}
+
+/// Adds the switches making the linker perform link-time optimization of the
+/// bitcode object files emitted with -flto.
+static void addLTOLinkerFlags(std::vector<std::string> &args) {
+  if (!opts::isUsingLTO()) {
+    return;
+  }
+
+  if (global.params.targetTriple->isOSDarwin()) {
+    // ld64 performs LTO itself, using libLTO.dylib.
+    if (!opts::ltoPlugin.empty()) {
+      args.push_back("-Wl,-lto_library," + opts::ltoPlugin);
+    }
+    return;
+  }
+
+  args.push_back("-Wl,-plugin," + getLTOPluginPath());
+
+  // Without this switch, the plugin merges the ThinLTO bitcode objects and
+  // performs full LTO.
+  if (opts::ltoMode == opts::LTO_Thin) {
+    args.push_back("-Wl,-plugin-opt=thinlto");
+  }
+
+  // Pass on the code generation settings, which aren't part of the bitcode.
+  args.push_back("-Wl,-plugin-opt=O" +
+                 std::to_string(static_cast<int>(codeGenOptLevel())));
+  if (gTargetMachine) {
+    args.push_back("-Wl,-plugin-opt=mcpu=" +
+                   gTargetMachine->getTargetCPU().str());
+    auto features = gTargetMachine->getTargetFeatureString();
+    if (!features.empty()) {
+      args.push_back("-Wl,-plugin-opt=-mattr=" + features.str());
+    }
+  }
+  if (opts::threads != 1) {
+    unsigned const jobs = opts::threads ? opts::threads.getValue()
+                                        : std::thread::hardware_concurrency();
+    args.push_back("-Wl,-plugin-opt=jobs=" + std::to_string(jobs));
+  }
+}
+
 static int linkObjToBinaryGcc(bool sharedLib, bool fullyStatic) {
   Logger::println("*** Linking executable ***");
 
@@ -209,6 +285,8 @@ static int linkObjToBinaryGcc(bool sharedLib, bool fullyStatic) {
     args.push_back("-fsanitize=thread");
   }
 
+  addLTOLinkerFlags(args);
+
   // additional linker switches
   for (unsigned i = 0; i < global.params.linkswitches->dim; i++) {
     const char *p =
@@ -668,7 +746,13 @@ static int linkObjToBinaryWin(bool sharedLib) {
 //////////////////////////////////////////////////////////////////////////////
 
 int linkObjToBinary() {
+  TimeTraceScope timeScope("Link");
+
   if (global.params.targetTriple->isWindowsMSVCEnvironment()) {
+    if (opts::isUsingLTO()) {
+      error(Loc(), "-flto is not supported for MSVC targets");
+      fatal();
+    }
     // TODO: Choose dynamic/static MSVCRT version based on staticFlag?
     return linkObjToBinaryWin(global.params.dll);
   }
@@ -680,6 +764,7 @@ int linkObjToBinary() {
 
 int createStaticLibrary() {
   Logger::println("*** Creating static library ***");
+  TimeTraceScope timeScope("Create static library");
 
   const bool isTargetWindows =
       global.params.targetTriple->isWindowsMSVCEnvironment();
@@ -690,6 +775,18 @@ int createStaticLibrary() {
   // build arguments
   std::vector<std::string> args;
 
+  // let ar index the symbols of LTO bitcode objects
+  if (opts::isUsingLTO()) {
+    if (isTargetWindows) {
+      error(Loc(), "-flto is not supported for MSVC targets");
+      fatal();
+    }
+    if (!global.params.targetTriple->isOSDarwin()) {
+      args.push_back("--plugin");
+      args.push_back(getLTOPluginPath());
+    }
+  }
+
   // ask ar to create a new library
   if (!isTargetWindows) {
     args.push_back("rcs");
@@ -27,6 +27,8 @@
 #include "driver/ldc-version.h"
 #include "driver/linker.h"
 #include "driver/targetmachine.h"
+#include "driver/timetrace.h"
+#include "driver/toobj.h"
 #include "gen/cl_helpers.h"
 #include "gen/irstate.h"
 #include "gen/linkage.h"
@@ -50,7 +52,6 @@
 #include "llvm/Support/StringSaver.h"
 #endif
 #include "llvm/Support/TargetRegistry.h"
-#include "llvm/Support/TargetSelect.h"
 #include "llvm/Target/TargetMachine.h"
 #if LDC_LLVM_VER >= 306
 #include "llvm/Target/TargetSubtargetInfo.h"
@@ -141,6 +142,7 @@ void printVersion() {
   // redirecting stdout to a file.
   fflush(stdout);
 
+  initializeAllTargets();
   llvm::TargetRegistry::printRegisteredTargetsForVersion();
   exit(EXIT_SUCCESS);
 }
@@ -436,6 +438,9 @@ void parseCommandLine(int argc, char **argv, Strings &sourceFiles,
                               const_cast<char **>(final_args.data()),
                               "LDC - the LLVM D compiler\n");
 
+  allArguments.assign(final_args.begin(), final_args.end());
+  global.params.hashSourceFiles = !ir2objCacheDir.empty();
+
   helpOnly = mCPU == "help" ||
              (std::find(mAttrs.begin(), mAttrs.end(), "help") != mAttrs.end());
 
@@ -515,6 +520,11 @@ void parseCommandLine(int argc, char **argv, Strings &sourceFiles,
   }
 #endif
 
+  // Sample profiles are matched to the code using debug line information.
+  if (!opts::sampleProfileFile.empty() && !global.params.symdebug) {
+    global.params.symdebug = 3;
+  }
+
   processVersions(debugArgs, "debug", DebugCondition::setGlobalLevel,
                   DebugCondition::addGlobalIdent);
   processVersions(versions, "version", VersionCondition::setGlobalLevel,
@@ -1054,19 +1064,18 @@ int cppmain(int argc, char **argv) {
   global.ldc_version = ldc::ldc_version;
   global.llvm_version = ldc::llvm_version;
 
-  // Initialize LLVM before parsing the command line so that --version shows
-  // registered targets.
-  llvm::InitializeAllTargetInfos();
-  llvm::InitializeAllTargets();
-  llvm::InitializeAllTargetMCs();
-  llvm::InitializeAllAsmPrinters();
-  llvm::InitializeAllAsmParsers();
+  // Initializing all LLVM targets takes a noticeable part of the startup time
+  // for small compilations, so only the native one is initialized here. The
+  // others are registered on demand when looking up the target (and for
+  // --version).
+  initializeNativeTarget();
 
   initializePasses();
 
   bool helpOnly;
   Strings files;
   parseCommandLine(argc, argv, files, helpOnly);
+  initializeTimeTrace();
 
   if (files.dim == 0 && !helpOnly) {
     cl::PrintHelpMessage();
@@ -1144,7 +1153,20 @@ int cppmain(int argc, char **argv) {
   }
 
   Strings libmodules;
-  return mars_mainBody(files, libmodules);
+  int status;
+  {
+    TimeTraceScope timeScope("Compile");
+    if (ir2obj::recoverCompilation()) {
+      // All object files have been recovered from the cache.
+      ir2obj::printStatistics();
+      ir2obj::pruneCache();
+      status = EXIT_SUCCESS;
+    } else {
+      status = mars_mainBody(files, libmodules);
+    }
+  }
+  writeTimeTraceProfile();
+  return status;
 }
 
 void codegenModules(Modules &modules) {
@@ -1172,6 +1194,15 @@ void codegenModules(Modules &modules) {
     }
   }
 
+  {
+    TimeTraceScope timeScope("Wait for backend threads");
+    waitForModuleWriters();
+  }
+  if (global.errors)
+    fatal();
+
+  ir2obj::recordCompilation();
+  ir2obj::printStatistics();
   ir2obj::pruneCache();
 
   freeRuntime();
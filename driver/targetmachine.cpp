@@ -375,8 +375,9 @@ static void addMipsABI(const llvm::Triple &triple,
 /// This has been adapted from the corresponding LLVM 3.2+ overload of
 /// llvm::TargetRegistry::lookupTarget. Once support for LLVM 3.1 is dropped,
 /// the registry method can be used instead.
-const llvm::Target *lookupTarget(const std::string &arch, llvm::Triple &triple,
-                                 std::string &errorMsg) {
+static const llvm::Target *lookupRegisteredTarget(const std::string &arch,
+                                                  llvm::Triple &triple,
+                                                  std::string &errorMsg) {
   // Allocate target machine. First, check whether the user has explicitly
   // specified an architecture to compile for. If so we have to look it up by
   // name, because it might be a backend that has no mapping to a target triple.
@@ -423,6 +424,38 @@ const llvm::Target *lookupTarget(const std::string &arch, llvm::Triple &triple,
   return target;
 }
 
+void initializeNativeTarget() {
+  llvm::InitializeNativeTarget();
+  llvm::InitializeNativeTargetAsmPrinter();
+  llvm::InitializeNativeTargetAsmParser();
+}
+
+void initializeAllTargets() {
+  static bool initialized = false;
+  if (initialized)
+    return;
+  initialized = true;
+
+  llvm::InitializeAllTargetInfos();
+  llvm::InitializeAllTargets();
+  llvm::InitializeAllTargetMCs();
+  llvm::InitializeAllAsmPrinters();
+  llvm::InitializeAllAsmParsers();
+}
+
+const llvm::Target *lookupTarget(const std::string &arch, llvm::Triple &triple,
+                                 std::string &errorMsg) {
+  const llvm::Target *target = lookupRegisteredTarget(arch, triple, errorMsg);
+  if (!target) {
+    // Only the native target is registered at startup, so retry with all
+    // targets LLVM has been built with.
+    initializeAllTargets();
+    errorMsg.clear();
+    target = lookupRegisteredTarget(arch, triple, errorMsg);
+  }
+  return target;
+}
+
 llvm::TargetMachine *
 createTargetMachine(std::string targetTriple, std::string arch, std::string cpu,
                     std::vector<std::string> attrs,
@@ -608,3 +641,11 @@ createTargetMachine(std::string targetTriple, std::string arch, std::string cpu,
                                      targetOptions, relocModel, codeModel,
                                      codeGenOptLevel);
 }
+
+llvm::TargetMachine *cloneTargetMachine(const llvm::TargetMachine &target) {
+  return target.getTarget().createTargetMachine(
+      llvm::Triple(target.getTargetTriple()).str(), target.getTargetCPU(),
+      target.getTargetFeatureString(), target.Options,
+      target.getRelocationModel(), target.getCodeModel(),
+      target.getOptLevel());
+}
@@ -58,6 +58,12 @@ llvm::TargetMachine *createTargetMachine(
     llvm::CodeModel::Model codeModel, llvm::CodeGenOpt::Level codeGenOptLevel,
     bool noFramePointerElim, bool noLinkerStripDead);
 
+/**
+ * Creates a new LLVM TargetMachine with the same configuration as the given
+ * one, e.g. for emitting code on another thread.
+ */
+llvm::TargetMachine *cloneTargetMachine(const llvm::TargetMachine &target);
+
 /**
  * Returns the Mips ABI which is used for code generation.
  *
@@ -67,7 +73,19 @@ llvm::TargetMachine *createTargetMachine(
  */
 MipsABI::Type getMipsABI();
 
-// Looks up a target based on an arch name and a target triple.
+/**
+ * Registers the host's LLVM target, which suffices for most compilations.
+ */
+void initializeNativeTarget();
+
+/**
+ * Registers all targets LLVM has been built with. Does nothing when called
+ * again.
+ */
+void initializeAllTargets();
+
+// Looks up a target based on an arch name and a target triple. Registers all
+// targets if the target is not the native one.
 const llvm::Target *lookupTarget(const std::string &arch, llvm::Triple &triple,
                                  std::string &errorMsg);
 
@@ -0,0 +1,209 @@
+//===-- timetrace.cpp -----------------------------------------------------===//
+//
+//                         LDC – the LLVM D compiler
+//
+// This file is distributed under the BSD-style LDC license. See the LICENSE
+// file for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "driver/timetrace.h"
+
+#include "mars.h"
+#include "root.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace {
+namespace cl = llvm::cl;
+
+cl::opt<bool> timeTrace(
+    "ftime-trace",
+    cl::desc("Record the time spent in the compiler's phases and write it as "
+             "Chrome trace event JSON"),
+    cl::ZeroOrMore);
+
+cl::opt<std::string> timeTraceFile(
+    "ftime-trace-file",
+    cl::desc("Write the -ftime-trace profile to <file> (default: <first "
+             "object file>.time-trace)"),
+    cl::value_desc("file"));
+
+cl::opt<unsigned> timeTraceGranularity(
+    "ftime-trace-granularity",
+    cl::desc("Minimum duration of recorded -ftime-trace spans in "
+             "microseconds (default: 500)"),
+    cl::value_desc("us"), cl::init(500));
+
+using Clock = std::chrono::steady_clock;
+
+struct OpenSpan {
+  std::string name;
+  std::string detail;
+  Clock::time_point start;
+};
+
+struct Event {
+  std::string name;
+  std::string detail;
+  int64_t start;    // in microseconds since initializeTimeTrace()
+  int64_t duration; // in microseconds
+  unsigned tid;
+};
+
+bool enabled = false;
+Clock::time_point startTime;
+int64_t startTimeSinceEpoch; // in microseconds
+
+// Closed spans of all threads.
+std::mutex eventsMutex;
+std::vector<Event> events;
+
+std::atomic<unsigned> nextThreadID(0);
+
+struct ThreadState {
+  unsigned const tid = nextThreadID++;
+  std::vector<OpenSpan> stack;
+};
+
+ThreadState &getThreadState() {
+  static thread_local ThreadState state;
+  return state;
+}
+
+int64_t toMicroseconds(Clock::duration d) {
+  return std::chrono::duration_cast<std::chrono::microseconds>(d).count();
+}
+
+void writeJSONString(llvm::raw_ostream &os, llvm::StringRef str) {
+  os << '"';
+  for (char c : str) {
+    switch (c) {
+    case '"':
+      os << "\\\"";
+      break;
+    case '\\':
+      os << "\\\\";
+      break;
+    case '\n':
+      os << "\\n";
+      break;
+    case '\t':
+      os << "\\t";
+      break;
+    default:
+      if (static_cast<unsigned char>(c) < 0x20) {
+        os << llvm::format("\\u%04x", static_cast<unsigned>(c));
+      } else {
+        os << c;
+      }
+    }
+  }
+  os << '"';
+}
+
+std::string getTimeTraceFileName() {
+  if (!timeTraceFile.empty())
+    return timeTraceFile;
+
+  std::string base = "ldc";
+  if (global.params.objfiles && global.params.objfiles->dim) {
+    base = FileName::removeExt((*global.params.objfiles)[0]);
+  } else if (global.params.exefile) {
+    base = global.params.exefile;
+  }
+  return base + ".time-trace";
+}
+} // anonymous namespace
+
+void initializeTimeTrace() {
+  if (!timeTrace)
+    return;
+
+  startTime = Clock::now();
+  startTimeSinceEpoch = std::chrono::duration_cast<std::chrono::microseconds>(
+                            std::chrono::system_clock::now().time_since_epoch())
+                            .count();
+  enabled = true;
+}
+
+bool timeTraceProfilerEnabled() { return enabled; }
+
+void timeTraceProfilerBegin(const char *name, const char *detail) {
+  if (!enabled)
+    return;
+
+  getThreadState().stack.push_back(
+      OpenSpan{name, detail ? detail : "", Clock::now()});
+}
+
+void timeTraceProfilerEnd() {
+  if (!enabled)
+    return;
+
+  ThreadState &state = getThreadState();
+  assert(!state.stack.empty() && "unbalanced timeTraceProfilerEnd()");
+  OpenSpan &span = state.stack.back();
+
+  int64_t const duration = toMicroseconds(Clock::now() - span.start);
+  if (duration >= timeTraceGranularity) {
+    Event event{std::move(span.name), std::move(span.detail),
+                toMicroseconds(span.start - startTime), duration, state.tid};
+    std::lock_guard<std::mutex> lock(eventsMutex);
+    events.push_back(std::move(event));
+  }
+  state.stack.pop_back();
+}
+
+void writeTimeTraceProfile() {
+  if (!enabled)
+    return;
+
+  std::lock_guard<std::mutex> lock(eventsMutex);
+  std::sort(events.begin(), events.end(), [](const Event &a, const Event &b) {
+    return a.start < b.start || (a.start == b.start && a.duration > b.duration);
+  });
+
+  std::string const filename = getTimeTraceFileName();
+#if LDC_LLVM_VER >= 306
+  std::error_code ec;
+  llvm::raw_fd_ostream os(filename, ec, llvm::sys::fs::F_Text);
+  std::string const errorMessage = ec ? ec.message() : "";
+#else
+  std::string errorMessage;
+  llvm::raw_fd_ostream os(filename.c_str(), errorMessage,
+                          llvm::sys::fs::F_Text);
+#endif
+  if (!errorMessage.empty()) {
+    error(Loc(), "cannot write time trace file '%s': %s", filename.c_str(),
+          errorMessage.c_str());
+    return;
+  }
+
+  os << "{\"traceEvents\":[\n";
+  for (const auto &e : events) {
+    os << "{\"ph\":\"X\",\"pid\":1,\"tid\":" << e.tid << ",\"ts\":" << e.start
+       << ",\"dur\":" << e.duration << ",\"name\":";
+    writeJSONString(os, e.name);
+    if (!e.detail.empty()) {
+      os << ",\"args\":{\"detail\":";
+      writeJSONString(os, e.detail);
+      os << '}';
+    }
+    os << "},\n";
+  }
+  os << "{\"ph\":\"M\",\"pid\":1,\"tid\":0,\"name\":\"process_name\","
+        "\"args\":{\"name\":\"ldc2\"}}\n";
+  os << "],\"beginningOfTime\":" << startTimeSinceEpoch << "}\n";
+
+  enabled = false;
+}
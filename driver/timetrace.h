@@ -0,0 +1,65 @@
+//===-- driver/timetrace.h - Compile-time phase profiler --------*- C++ -*-===//
+//
+//                         LDC – the LLVM D compiler
+//
+// This file is distributed under the BSD-style LDC license. See the LICENSE
+// file for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// Records nested, timestamped spans of the compiler's phases (-ftime-trace)
+// and writes them in the Chrome trace event format, to be viewed with
+// chrome://tracing or speedscope.
+//
+// The D frontend uses the same profiler via driver/timetrace.d.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LDC_DRIVER_TIMETRACE_H
+#define LDC_DRIVER_TIMETRACE_H
+
+#include "llvm/ADT/STLExtras.h"
+#include <string>
+
+/// Starts recording if -ftime-trace is given.
+void initializeTimeTrace();
+
+/// Writes the recorded spans to the -ftime-trace-file.
+void writeTimeTraceProfile();
+
+bool timeTraceProfilerEnabled();
+
+/// Opens a new span on the current thread, nested into the currently open one.
+void timeTraceProfilerBegin(const char *name, const char *detail);
+
+/// Closes the innermost open span of the current thread.
+void timeTraceProfilerEnd();
+
+/// Records a span for the lifetime of the object. The detail (e.g. a symbol
+/// name) is only computed if the profiler is enabled.
+class TimeTraceScope {
+  bool const active;
+
+public:
+  explicit TimeTraceScope(const char *name, const char *detail = "")
+      : active(timeTraceProfilerEnabled()) {
+    if (active)
+      timeTraceProfilerBegin(name, detail);
+  }
+
+  TimeTraceScope(const char *name, llvm::function_ref<std::string()> detail)
+      : active(timeTraceProfilerEnabled()) {
+    if (active)
+      timeTraceProfilerBegin(name, detail().c_str());
+  }
+
+  ~TimeTraceScope() {
+    if (active)
+      timeTraceProfilerEnd();
+  }
+
+  TimeTraceScope(const TimeTraceScope &) = delete;
+  TimeTraceScope &operator=(const TimeTraceScope &) = delete;
+};
+
+#endif
@@ -12,6 +12,7 @@
 #include "driver/cl_options.h"
 #include "driver/ir2obj_cache.h"
 #include "driver/targetmachine.h"
+#include "driver/timetrace.h"
 #include "driver/tool.h"
 #include "gen/irstate.h"
 #include "gen/logger.h"
@@ -40,8 +41,26 @@
 #include "llvm/Target/TargetSubtargetInfo.h"
 #endif
 #include "llvm/IR/Module.h"
+#if LDC_LLVM_VER >= 309
+#include "llvm/Bitcode/BitcodeWriterPass.h"
+#include "llvm/Transforms/Utils/SplitModule.h"
+#endif
+#if LDC_LLVM_VER >= 306
+#include "llvm/IRReader/IRReader.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/SourceMgr.h"
+#endif
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdarg>
 #include <cstddef>
+#include <cstdio>
+#include <deque>
 #include <fstream>
+#include <memory>
+#include <mutex>
+#include <thread>
 
 #if LDC_LLVM_VER >= 306
 using LLErrorInfo = std::error_code;
@@ -55,12 +74,61 @@ static llvm::cl::opt<bool>
     NoIntegratedAssembler("no-integrated-as", llvm::cl::Hidden,
                           llvm::cl::desc("Disable integrated assembler"));
 
+static unsigned numBackendThreads() {
+  if (opts::threads == 0) {
+    return std::max(1u, std::thread::hardware_concurrency());
+  }
+  return opts::threads;
+}
+
+/// The error of the backend job running on the current thread, or null on the
+/// main thread (see backendError()).
+static thread_local std::string *currentJobError = nullptr;
+
+bool backendError(const char *format, ...) {
+  va_list ap;
+  va_start(ap, format);
+  if (!currentJobError) {
+    verror(Loc(), format, ap);
+    va_end(ap);
+    fatal();
+  }
+  if (currentJobError->empty()) {
+    char buffer[1024];
+    vsnprintf(buffer, sizeof(buffer), format, ap);
+    *currentJobError = buffer;
+  }
+  va_end(ap);
+  return false;
+}
+
+namespace {
+/// Makes backendError() store the first error on the current thread in the
+/// given string, until the scope is left.
+class JobErrorScope {
+public:
+  explicit JobErrorScope(std::string &error) : saved(currentJobError) {
+    currentJobError = &error;
+  }
+  ~JobErrorScope() { currentJobError = saved; }
+
+private:
+  std::string *saved;
+};
+
+/// Returns whether backendError() has been called for the current job.
+bool currentJobFailed() { return currentJobError && !currentJobError->empty(); }
+}
+
 // based on llc code, University of Illinois Open Source License
 static void codegenModule(llvm::TargetMachine &Target, llvm::Module &m,
                           llvm::raw_fd_ostream &out,
                           llvm::TargetMachine::CodeGenFileType fileType) {
   using namespace llvm;
 
+  TimeTraceScope timeScope("Machine code generation",
+                           [&m] { return m.getModuleIdentifier(); });
+
 // Create a PassManager to hold and optimize the collection of passes we are
 // about to build.
 #if LDC_LLVM_VER >= 307
@@ -106,15 +174,8 @@ static void codegenModule(llvm::TargetMachine &Target, llvm::Module &m,
   Passes.run(m);
 }
 
-static void assemble(const std::string &asmpath, const std::string &objpath) {
-  std::vector<std::string> args;
-  args.push_back("-O3");
-  args.push_back("-c");
-  args.push_back("-xassembler");
-  args.push_back(asmpath);
-  args.push_back("-o");
-  args.push_back(objpath);
-
+/// Appends the gcc switches selecting the target architecture variant.
+static void appendTargetArchArgs(std::vector<std::string> &args) {
   // Only specify -m32/-m64 for architectures where the two variants actually
   // exist (as e.g. the GCC ARM toolchain doesn't recognize the switches).
   // MIPS does not have -m32/-m64 but requires -mabi=.
@@ -154,14 +215,25 @@ static void assemble(const std::string &asmpath, const std::string &objpath) {
       }
     }
   }
+}
+
+static bool assemble(const std::string &asmpath, const std::string &objpath) {
+  std::vector<std::string> args;
+  args.push_back("-O3");
+  args.push_back("-c");
+  args.push_back("-xassembler");
+  args.push_back(asmpath);
+  args.push_back("-o");
+  args.push_back(objpath);
+  appendTargetArchArgs(args);
 
   // Run the compiler to assembly the program.
   std::string gcc(getGcc());
   int R = executeToolAndWait(gcc, args, global.params.verbose);
   if (R) {
-    error(Loc(), "Error while invoking external assembler.");
-    fatal();
+    return backendError("Error while invoking external assembler.");
   }
+  return true;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -344,8 +416,14 @@ public:
   }
 };
 
-void writeObjectFile(llvm::Module *m, std::string &filename) {
+bool writeObjectFile(llvm::Module *m, llvm::TargetMachine &target,
+                     const std::string &filename) {
   IF_LOG Logger::println("Writing object file to: %s", filename.c_str());
+
+  // The output file may be a link to an ir2obj cache entry (as created by
+  // older compiler versions), which must not be overwritten in place.
+  llvm::sys::fs::remove(filename);
+
   LLErrorInfo errinfo;
   {
     llvm::raw_fd_ostream out(filename.c_str(), errinfo, llvm::sys::fs::F_None);
@@ -355,47 +433,240 @@ void writeObjectFile(llvm::Module *m, std::string &filename) {
     if (errinfo.empty())
 #endif
     {
-      codegenModule(*gTargetMachine, *m, out,
-                    llvm::TargetMachine::CGFT_ObjectFile);
+      codegenModule(target, *m, out, llvm::TargetMachine::CGFT_ObjectFile);
     } else {
-      error(Loc(), "cannot write object file '%s': %s", filename.c_str(),
-            ERRORINFO_STRING(errinfo));
-      fatal();
+      return backendError("cannot write object file '%s': %s",
+                          filename.c_str(), ERRORINFO_STRING(errinfo));
     }
   }
+  return true;
 }
-} // end of anonymous namespace
 
-void writeModule(llvm::Module *m, std::string filename) {
-  // There is no integrated assembler on AIX because XCOFF is not supported.
-  // Starting with LLVM 3.5 the integrated assembler can be used with MinGW.
-  bool const assembleExternally =
-      global.params.output_o &&
-      (NoIntegratedAssembler ||
-       global.params.targetTriple->getOS() == llvm::Triple::AIX);
+/// Writes the module as LLVM bitcode object file for link-time optimization
+/// (-flto). For ThinLTO, the module summary index is included.
+bool writeBitcodeObjectFile(llvm::Module *m, const std::string &filename) {
+  IF_LOG Logger::println("Writing LTO bitcode object file to: %s",
+                         filename.c_str());
+  TimeTraceScope timeScope("Write bitcode object file", filename.c_str());
 
-  // Use cached object code if possible
-  bool useIR2ObjCache = !opts::ir2objCacheDir.empty();
-  llvm::SmallString<32> moduleHash;
-  if (useIR2ObjCache && global.params.output_o && !assembleExternally) {
-    llvm::SmallString<128> cacheDir(opts::ir2objCacheDir.c_str());
-    llvm::sys::fs::make_absolute(cacheDir);
-    opts::ir2objCacheDir = cacheDir.c_str();
+  // The output file may be a link to an ir2obj cache entry (as created by
+  // older compiler versions), which must not be overwritten in place.
+  llvm::sys::fs::remove(filename);
 
-    IF_LOG Logger::println("Use IR-to-Object cache in %s",
-                           opts::ir2objCacheDir.c_str());
-    LOG_SCOPE
+  LLErrorInfo errinfo;
+  llvm::raw_fd_ostream out(filename.c_str(), errinfo, llvm::sys::fs::F_None);
+#if LDC_LLVM_VER >= 306
+  if (errinfo)
+#else
+  if (!errinfo.empty())
+#endif
+  {
+    return backendError("cannot write object file '%s': %s", filename.c_str(),
+                        ERRORINFO_STRING(errinfo));
+  }
 
-    ir2obj::calculateModuleHash(m, moduleHash);
-    std::string cacheFile = ir2obj::cacheLookup(moduleHash);
-    if (!cacheFile.empty()) {
-      ir2obj::recoverObjectFile(moduleHash, filename);
-      return;
+#if LDC_LLVM_VER >= 309
+  llvm::legacy::PassManager passes;
+  passes.add(llvm::createBitcodeWriterPass(
+      out, /*ShouldPreserveUseListOrder=*/false,
+      /*EmitSummaryIndex=*/opts::ltoMode == opts::LTO_Thin));
+  passes.run(*m);
+#else
+  llvm::WriteBitcodeToFile(m, out);
+#endif
+  return true;
+}
+
+#if LDC_LLVM_VER >= 309
+/// Emits the object file from function-level partitions of the module (see
+/// llvm::SplitModule), which are combined by a relocatable link. The
+/// partitions are emitted on up to `numThreads` threads. With the ir2obj cache,
+/// each partition is also cached on its own, so that after a small change to a
+/// big module only the affected partitions need to be emitted again.
+bool writeSplitObjectFile(llvm::Module *m, llvm::TargetMachine &target,
+                          const std::string &filename, unsigned numPartitions,
+                          unsigned numThreads) {
+  IF_LOG Logger::println("Writing object file to: %s (%u partitions)",
+                         filename.c_str(), numPartitions);
+  LOG_SCOPE
+
+  struct Partition {
+    std::string bitcode;
+    std::string file;
+    llvm::SmallString<32> hash;
+  };
+  std::vector<Partition> partitions;
+
+  // llvm::SplitModule() takes ownership of the module, so split a copy. The
+  // partitions are serialized to bitcode, as LLVM contexts cannot be shared
+  // between threads.
+  {
+    llvm::LLVMContext context;
+    std::unique_ptr<llvm::Module> copy;
+    {
+      std::string bitcode;
+      {
+        llvm::raw_string_ostream os(bitcode);
+        llvm::WriteBitcodeToFile(m, os);
+      }
+      llvm::SMDiagnostic err;
+      copy = llvm::parseIR(llvm::MemoryBufferRef(bitcode, filename), err,
+                           context);
+      if (!copy) {
+        return backendError("cannot read back LLVM bitcode for '%s': %s",
+                            filename.c_str(), err.getMessage().str().c_str());
+      }
     }
+
+    // Keep module-local symbols (string literals, TypeInfo helpers, ...)
+    // local by placing them in the same partition as all their users.
+    // Otherwise SplitModule turns them into hidden globals, which survive the
+    // relocatable link and clash with the ones of other split object files.
+    TimeTraceScope splitScope("Split module", filename.c_str());
+    llvm::SplitModule(std::move(copy), numPartitions,
+                      [&partitions](std::unique_ptr<llvm::Module> part) {
+                        partitions.emplace_back();
+                        llvm::raw_string_ostream os(
+                            partitions.back().bitcode);
+                        llvm::WriteBitcodeToFile(part.get(), os);
+                      },
+                      /*PreserveLocals=*/true);
+  }
+
+  bool const useIR2ObjCache = !opts::ir2objCacheDir.empty();
+  std::vector<Partition *> pending;
+  for (auto &p : partitions) {
+    llvm::SmallString<128> partFile;
+    if (llvm::sys::fs::createUniqueFile(llvm::Twine(filename) +
+                                            ".part%%%%%%%%." + global.obj_ext,
+                                        partFile)) {
+      for (const auto &q : partitions) {
+        if (!q.file.empty())
+          llvm::sys::fs::remove(q.file);
+      }
+      return backendError("cannot create object file partition for '%s'",
+                          filename.c_str());
+    }
+    p.file = partFile.str();
+
+    if (useIR2ObjCache) {
+      ir2obj::calculateBitcodeHash(p.bitcode, p.hash);
+      if (!ir2obj::cacheLookup(p.hash).empty() &&
+          ir2obj::recoverObjectFile(p.hash, p.file)) {
+        std::string().swap(p.bitcode);
+        continue;
+      }
+    }
+    pending.push_back(&p);
+  }
+
+  // Emit the remaining partitions. The debug log is not thread-safe. Errors
+  // are collected per thread and reported once all threads are done.
+  std::atomic<size_t> next(0);
+  std::mutex errorMutex;
+  std::string firstError;
+  auto emitPending = [&] {
+    std::string threadError;
+    {
+      JobErrorScope errorScope(threadError);
+      std::unique_ptr<llvm::TargetMachine> partTarget(
+          cloneTargetMachine(target));
+      for (size_t i; (i = next++) < pending.size();) {
+        Partition &p = *pending[i];
+        llvm::LLVMContext context;
+        llvm::SMDiagnostic err;
+        std::unique_ptr<llvm::Module> part = llvm::parseIR(
+            llvm::MemoryBufferRef(p.bitcode, p.file), err, context);
+        if (!part) {
+          backendError("cannot read back LLVM bitcode for '%s': %s",
+                       p.file.c_str(), err.getMessage().str().c_str());
+          break;
+        }
+        if (!writeObjectFile(part.get(), *partTarget, p.file) ||
+            (useIR2ObjCache && !ir2obj::cacheObjectFile(p.file, p.hash))) {
+          break;
+        }
+      }
+    }
+    if (!threadError.empty()) {
+      std::lock_guard<std::mutex> lock(errorMutex);
+      if (firstError.empty())
+        firstError = threadError;
+    }
+  };
+  std::vector<std::thread> workers;
+  if (!Logger::enabled()) {
+    for (size_t i = 1; i < std::min<size_t>(numThreads, pending.size()); ++i) {
+      workers.emplace_back(emitPending);
+    }
+  }
+  emitPending();
+  for (auto &worker : workers) {
+    worker.join();
+  }
+  if (!firstError.empty()) {
+    for (const auto &p : partitions) {
+      llvm::sys::fs::remove(p.file);
+    }
+    return backendError("%s", firstError.c_str());
+  }
+
+  // The output file may be a link to an ir2obj cache entry (as created by
+  // older compiler versions), which must not be overwritten in place.
+  llvm::sys::fs::remove(filename);
+
+  std::vector<std::string> args;
+  args.push_back("-nostdlib");
+  args.push_back("-r");
+  appendTargetArchArgs(args);
+  args.push_back("-o");
+  args.push_back(filename);
+  for (const auto &p : partitions) {
+    args.push_back(p.file);
+  }
+
+  TimeTraceScope linkScope("Combine object file partitions", filename.c_str());
+  int R = executeToolAndWait(getGcc(), args, global.params.verbose);
+  for (const auto &p : partitions) {
+    llvm::sys::fs::remove(p.file);
+  }
+  if (R) {
+    return backendError("Error while combining the object file partitions.");
   }
+  return true;
+}
 
+/// Returns the number of partitions the module is split into for machine code
+/// generation: for -singleobj, where all D modules end up in a single LLVM
+/// module, one per backend thread; with -ir2obj-cache-partitions, the number
+/// of individually cached partitions. The partitions are combined by the gcc
+/// driver, so without one the module is emitted as a single object file.
+unsigned numObjectFilePartitions() {
+  if (global.params.targetTriple->isWindowsMSVCEnvironment()) {
+    return 1;
+  }
+  // May be called from the backend threads.
+  static bool const haveGcc = isGccAvailable();
+  if (!haveGcc) {
+    return 1;
+  }
+  unsigned const numThreadPartitions =
+      global.params.oneobj ? numBackendThreads() : 1;
+  return std::max(numThreadPartitions, ir2obj::numCachePartitions());
+}
+#endif
+
+/// Runs the optimizer on the given module and writes all requested output
+/// files. The object file is added to the IR-to-object cache under the given
+/// non-empty hashes.
+void optimizeAndEmit(llvm::Module *m, llvm::TargetMachine &target,
+                     const std::string &filename, bool assembleExternally,
+                     llvm::StringRef moduleHash, llvm::StringRef sourceHash) {
   // run optimizer
-  ldc_optimize_module(m);
+  ldc_optimize_module(m, target);
+  if (currentJobFailed()) {
+    return;
+  }
 
   // eventually do our own path stuff, dmd's is a bit strange.
   using LLPath = llvm::SmallString<128>;
@@ -404,9 +675,9 @@ void writeModule(llvm::Module *m, std::string filename) {
   const auto directory = llvm::sys::path::parent_path(filename);
   if (!directory.empty()) {
     if (auto ec = llvm::sys::fs::create_directories(directory)) {
-      error(Loc(), "failed to create output directory: %s\n%s",
-            directory.data(), ec.message().c_str());
-      fatal();
+      backendError("failed to create output directory: %s\n%s",
+                   directory.str().c_str(), ec.message().c_str());
+      return;
     }
   }
 
@@ -418,9 +689,9 @@ void writeModule(llvm::Module *m, std::string filename) {
     LLErrorInfo errinfo;
     llvm::raw_fd_ostream bos(bcpath.c_str(), errinfo, llvm::sys::fs::F_None);
     if (bos.has_error()) {
-      error(Loc(), "cannot write LLVM bitcode file '%s': %s", bcpath.c_str(),
-            ERRORINFO_STRING(errinfo));
-      fatal();
+      backendError("cannot write LLVM bitcode file '%s': %s", bcpath.c_str(),
+                   ERRORINFO_STRING(errinfo));
+      return;
     }
     llvm::WriteBitcodeToFile(m, bos);
   }
@@ -433,9 +704,9 @@ void writeModule(llvm::Module *m, std::string filename) {
     LLErrorInfo errinfo;
     llvm::raw_fd_ostream aos(llpath.c_str(), errinfo, llvm::sys::fs::F_None);
     if (aos.has_error()) {
-      error(Loc(), "cannot write LLVM IR file '%s': %s", llpath.c_str(),
-            ERRORINFO_STRING(errinfo));
-      fatal();
+      backendError("cannot write LLVM IR file '%s': %s", llpath.c_str(),
+                   ERRORINFO_STRING(errinfo));
+      return;
     }
     AssemblyAnnotator annotator;
     m->print(aos, &annotator);
@@ -459,29 +730,259 @@ void writeModule(llvm::Module *m, std::string filename) {
       if (errinfo.empty())
 #endif
       {
-        codegenModule(*gTargetMachine, *m, out,
-                      llvm::TargetMachine::CGFT_AssemblyFile);
+        codegenModule(target, *m, out, llvm::TargetMachine::CGFT_AssemblyFile);
       } else {
-        error(Loc(), "cannot write asm: %s", ERRORINFO_STRING(errinfo));
-        fatal();
+        backendError("cannot write asm: %s", ERRORINFO_STRING(errinfo));
+        return;
       }
     }
 
-    if (assembleExternally) {
-      assemble(spath.str(), filename);
-    }
+    bool const assembled =
+        !assembleExternally || assemble(spath.str(), filename);
 
     if (!global.params.output_s) {
       llvm::sys::fs::remove(spath.str());
     }
+    if (!assembled) {
+      return;
+    }
   }
 
   if (global.params.output_o && !assembleExternally) {
-    writeObjectFile(m, filename);
-    if (useIR2ObjCache) {
-      ir2obj::cacheObjectFile(filename, moduleHash);
+    bool written;
+    if (opts::isUsingLTO()) {
+      written = writeBitcodeObjectFile(m, filename);
+    } else {
+#if LDC_LLVM_VER >= 309
+      unsigned const numPartitions = numObjectFilePartitions();
+      if (numPartitions > 1) {
+        written = writeSplitObjectFile(
+            m, target, filename, numPartitions,
+            global.params.oneobj ? numBackendThreads() : 1);
+      } else
+#endif
+        written = writeObjectFile(m, target, filename);
+    }
+    if (written && !moduleHash.empty() &&
+        ir2obj::cacheObjectFile(filename, moduleHash)) {
+      if (!sourceHash.empty()) {
+        ir2obj::addCacheAlias(moduleHash, sourceHash);
+      }
+    }
+  }
+}
+
+#if LDC_LLVM_VER >= 306
+/// Optimizes and emits modules on a pool of background threads (-threads), so
+/// that the frontend can generate the IR for the next module in the meantime.
+///
+/// LLVM contexts cannot be shared between threads, so each module is handed
+/// over as in-memory bitcode and re-materialized in a fresh context on the
+/// worker thread. Each worker owns its own TargetMachine.
+class BackendThreadPool {
+public:
+  explicit BackendThreadPool(unsigned numThreads) {
+    for (unsigned i = 0; i < numThreads; ++i) {
+      std::shared_ptr<llvm::TargetMachine> target(
+          cloneTargetMachine(*gTargetMachine));
+      workers.emplace_back([this, target] { run(*target); });
+    }
+  }
+
+  /// Enqueues the given module bitcode for optimization and emission. Blocks
+  /// while too many modules are already waiting, to bound memory usage.
+  void enqueue(std::string bitcode, const std::string &filename,
+               bool assembleExternally, llvm::StringRef moduleHash,
+               llvm::StringRef sourceHash) {
+    Job job;
+    job.bitcode = std::move(bitcode);
+    job.filename = filename;
+    job.assembleExternally = assembleExternally;
+    job.moduleHash = moduleHash.str();
+    job.sourceHash = sourceHash.str();
+
+    std::unique_lock<std::mutex> lock(mutex);
+    queueNotFull.wait(lock,
+                      [this] { return queue.size() < 2 * workers.size(); });
+    queue.push_back(std::move(job));
+    queueNotEmpty.notify_one();
+  }
+
+  /// Returns the errors of the failed jobs. Only valid after join().
+  const std::vector<std::string> &getErrors() const { return errors; }
+
+  /// Waits until all enqueued modules have been written.
+  void join() {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      done = true;
+    }
+    queueNotEmpty.notify_all();
+    for (auto &worker : workers) {
+      worker.join();
+    }
+    workers.clear();
+  }
+
+private:
+  struct Job {
+    std::string bitcode;
+    std::string filename;
+    bool assembleExternally;
+    std::string moduleHash;
+    std::string sourceHash;
+  };
+
+  void run(llvm::TargetMachine &target) {
+    for (;;) {
+      Job job;
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        queueNotEmpty.wait(lock, [this] { return done || !queue.empty(); });
+        if (queue.empty()) {
+          return;
+        }
+        job = std::move(queue.front());
+        queue.pop_front();
+        queueNotFull.notify_one();
+      }
+
+      // error() and fatal() are not thread-safe, so the job's error is
+      // handed back to the main thread, which reports it in
+      // waitForModuleWriters().
+      std::string jobError;
+      {
+        JobErrorScope errorScope(jobError);
+        llvm::LLVMContext context;
+        llvm::SMDiagnostic err;
+        std::unique_ptr<llvm::Module> m = llvm::parseIR(
+            llvm::MemoryBufferRef(job.bitcode, job.filename), err, context);
+        std::string().swap(job.bitcode);
+        if (m) {
+          optimizeAndEmit(m.get(), target, job.filename,
+                          job.assembleExternally, job.moduleHash,
+                          job.sourceHash);
+        } else {
+          backendError("cannot read back LLVM bitcode for '%s': %s",
+                       job.filename.c_str(), err.getMessage().str().c_str());
+        }
+      }
+      if (!jobError.empty()) {
+        std::lock_guard<std::mutex> lock(mutex);
+        errors.push_back(std::move(jobError));
+      }
     }
   }
+
+  std::vector<std::thread> workers;
+  std::deque<Job> queue;
+  std::vector<std::string> errors;
+  std::mutex mutex;
+  std::condition_variable queueNotEmpty;
+  std::condition_variable queueNotFull;
+  bool done = false;
+};
+
+/// The background thread pool, lazily created by the first writeModule() call
+/// that may use it. Not a static object so that fatal() does not destroy
+/// joinable threads.
+BackendThreadPool *backendThreadPool = nullptr;
+#endif
+} // end of anonymous namespace
+
+void writeModule(llvm::Module *m, std::string filename,
+                 llvm::StringRef sourceHash) {
+  // There is no integrated assembler on AIX because XCOFF is not supported.
+  // Starting with LLVM 3.5 the integrated assembler can be used with MinGW.
+  // LTO bitcode objects are never assembled.
+  bool const assembleExternally =
+      global.params.output_o && !opts::isUsingLTO() &&
+      (NoIntegratedAssembler ||
+       global.params.targetTriple->getOS() == llvm::Triple::AIX);
+
+#if LDC_LLVM_VER >= 306
+  // Hand the module over to the backend threads if requested. The textual IR
+  // annotator and the (non-thread-safe) debug log are only supported on the
+  // main thread. A -singleobj module is split for codegen instead.
+  bool const useBackendThreads = numBackendThreads() > 1 &&
+                                 !global.params.oneobj && !Logger::enabled() &&
+                                 !global.params.output_ll;
+#else
+  bool const useBackendThreads = false;
+#endif
+
+  // The backend threads need the module as bitcode. If it is needed for the
+  // cache too, only serialize it once.
+  std::string bitcode;
+  if (useBackendThreads) {
+    llvm::raw_string_ostream os(bitcode);
+    llvm::WriteBitcodeToFile(m, os);
+  }
+
+  // Use cached object code if possible
+  bool useIR2ObjCache = !opts::ir2objCacheDir.empty();
+  llvm::SmallString<32> moduleHash;
+  if (useIR2ObjCache && global.params.output_o && !assembleExternally) {
+    // Make the path absolute only once, as it may be read concurrently by the
+    // backend threads afterwards.
+    if (!llvm::sys::path::is_absolute(opts::ir2objCacheDir)) {
+      llvm::SmallString<128> cacheDir(opts::ir2objCacheDir.c_str());
+      llvm::sys::fs::make_absolute(cacheDir);
+      opts::ir2objCacheDir = cacheDir.c_str();
+    }
+
+    IF_LOG Logger::println("Use IR-to-Object cache in %s",
+                           opts::ir2objCacheDir.c_str());
+    LOG_SCOPE
+
+    if (useBackendThreads) {
+      ir2obj::calculateBitcodeHash(bitcode, moduleHash);
+    } else {
+      ir2obj::calculateModuleHash(m, moduleHash);
+    }
+    std::string cacheFile = ir2obj::cacheLookup(moduleHash);
+    if (!cacheFile.empty() &&
+        ir2obj::recoverObjectFile(moduleHash, filename)) {
+      if (!sourceHash.empty()) {
+        ir2obj::addCacheAlias(moduleHash, sourceHash);
+      }
+      return;
+    }
+  } else {
+    sourceHash = "";
+  }
+
+#if LDC_LLVM_VER >= 306
+  if (useBackendThreads) {
+    if (!backendThreadPool) {
+      backendThreadPool = new BackendThreadPool(numBackendThreads());
+    }
+    backendThreadPool->enqueue(std::move(bitcode), filename,
+                               assembleExternally, moduleHash, sourceHash);
+    return;
+  }
+#endif
+
+  optimizeAndEmit(m, *gTargetMachine, filename, assembleExternally,
+                  moduleHash, sourceHash);
+}
+
+void waitForModuleWriters() {
+#if LDC_LLVM_VER >= 306
+  if (backendThreadPool) {
+    backendThreadPool->join();
+    std::vector<std::string> errors = backendThreadPool->getErrors();
+    delete backendThreadPool;
+    backendThreadPool = nullptr;
+
+    for (const auto &message : errors) {
+      error(Loc(), "%s", message.c_str());
+    }
+    if (!errors.empty()) {
+      fatal();
+    }
+  }
+#endif
 }
 
 #undef ERRORINFO_STRING
@@ -14,12 +14,31 @@
 #ifndef LDC_DRIVER_TOOBJ_H
 #define LDC_DRIVER_TOOBJ_H
 
+#include "llvm/ADT/StringRef.h"
 #include <string>
 
 namespace llvm {
 class Module;
 }
 
-void writeModule(llvm::Module *m, std::string filename);
+/// Optimizes the given module and writes the requested output files. With
+/// -threads, this may be deferred to a background thread; the module itself
+/// is no longer needed after this call returns.
+/// If sourceHash is non-empty, the object file is additionally registered
+/// under that pre-codegen key in the IR-to-object cache.
+void writeModule(llvm::Module *m, std::string filename,
+                 llvm::StringRef sourceHash = llvm::StringRef());
+
+/// Waits for all deferred writeModule() jobs to finish, and reports their
+/// errors.
+void waitForModuleWriters();
+
+/// Reports an error while optimizing or writing a module (printf-style).
+///
+/// On the main thread, this is the same as error() followed by fatal(). On the
+/// backend threads (-threads), which must not use error() and fatal(), the
+/// first error of the current job is stored for waitForModuleWriters() to
+/// report, and false is returned so that the caller can give up on the job.
+bool backendError(const char *format, ...);
 
 #endif
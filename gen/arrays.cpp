@@ -937,14 +937,85 @@ static LLValue *DtoArrayEqCmp_impl(Loc &loc, const char *func, DValue *l,
   return gIR->funcGen().callOrInvoke(fn, args).getInstruction();
 }
 
+////////////////////////////////////////////////////////////////////////////////
+// Determines whether arrays of the given element type can be compared for
+// equality bitwise, i.e. whether the TypeInfo would end up doing a memcmp
+// anyway.
+static bool isBitwiseEqualityComparable(Type *elemType) {
+  Type *t = elemType->baseElemOf();
+  if (t->ty == Tstruct) {
+    StructDeclaration *sd = static_cast<TypeStruct *>(t)->sym;
+    return !needOpEquals(sd) && !sd->aliasthis;
+  }
+  return (t->isintegral() && t->ty != Tvector) || t->ty == Tpointer ||
+         t->ty == Tdelegate || t->ty == Tvoid;
+}
+
+// Compares the contents of two arrays of the given dynamic array type using
+// memcmp, after checking the lengths for equality (i1 result).
+static LLValue *DtoArrayEqualsBitwise(Loc &loc, Type *commonType, DValue *l,
+                                      DValue *r) {
+  LLValue *len = DtoArrayLen(l);
+  LLValue *lenEq = gIR->ir->CreateICmpEQ(len, DtoArrayLen(r), ".lenEq");
+
+  llvm::BasicBlock *entrybb = gIR->scopebb();
+  llvm::BasicBlock *cmpbb = gIR->insertBB("arrayeq.memcmp");
+  llvm::BasicBlock *endbb = gIR->insertBBAfter(cmpbb, "arrayeq.end");
+  llvm::BranchInst::Create(cmpbb, endbb, lenEq, gIR->scopebb());
+
+  gIR->scope() = IRScope(cmpbb);
+  LLValue *size = gIR->ir->CreateMul(
+      len, DtoConstSize_t(commonType->nextOf()->size()), ".size");
+  LLValue *cmp = DtoMemCmp(DtoArrayPtr(l), DtoArrayPtr(r), size);
+  LLValue *contentsEq =
+      gIR->ir->CreateICmpEQ(cmp, LLConstantInt::get(cmp->getType(), 0));
+  llvm::BasicBlock *cmpendbb = gIR->scopebb();
+  llvm::BranchInst::Create(endbb, gIR->scopebb());
+
+  gIR->scope() = IRScope(endbb);
+  llvm::PHINode *res =
+      gIR->ir->CreatePHI(LLType::getInt1Ty(gIR->context()), 2, ".arrayEq");
+  res->addIncoming(DtoConstBool(false), entrybb);
+  res->addIncoming(contentsEq, cmpendbb);
+  return res;
+}
+
+// Lexicographically compares two arrays of unsigned bytes (e.g. chars) like
+// _adCmpChar, using memcmp on the common prefix (i32 result).
+static LLValue *DtoArrayCompareBytes(Loc &loc, DValue *l, DValue *r) {
+  LLValue *len1 = DtoArrayLen(l);
+  LLValue *len2 = DtoArrayLen(r);
+  LLValue *shorter = gIR->ir->CreateICmpULT(len1, len2);
+  LLValue *minLen = gIR->ir->CreateSelect(shorter, len1, len2, ".minLen");
+  LLValue *cmp = DtoMemCmp(DtoArrayPtr(l), DtoArrayPtr(r), minLen);
+
+  // If the common prefix is equal, the shorter array is smaller.
+  LLValue *lenCmp = gIR->ir->CreateSelect(
+      shorter, DtoConstInt(-1),
+      gIR->ir->CreateSelect(gIR->ir->CreateICmpUGT(len1, len2),
+                            DtoConstInt(1), DtoConstInt(0)));
+  return gIR->ir->CreateSelect(
+      gIR->ir->CreateICmpEQ(cmp, DtoConstInt(0)), lenCmp, cmp, ".arrayCmp");
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 LLValue *DtoArrayEquals(Loc &loc, TOK op, DValue *l, DValue *r) {
   LLValue *res = nullptr;
 
+  // find common dynamic array type
+  Type *commonType = l->type->toBasetype()->nextOf()->arrayOf();
+
   // optimize comparisons against null by rewriting to `l.length op 0`
   if (r->isNull()) {
     const auto predicate = eqTokToICmpPred(op);
     res = gIR->ir->CreateICmp(predicate, DtoArrayLen(l), DtoConstSize_t(0));
+  } else if (isBitwiseEqualityComparable(commonType->nextOf())) {
+    l = DtoCastArray(loc, l, commonType);
+    r = DtoCastArray(loc, r, commonType);
+    res = DtoArrayEqualsBitwise(loc, commonType, l, r);
+    if (eqTokToICmpPred(op) == llvm::ICmpInst::ICMP_NE) {
+      res = gIR->ir->CreateNot(res);
+    }
   } else {
     res = DtoArrayEqCmp_impl(loc, "_adEq2", l, r, true);
     const auto predicate = eqTokToICmpPred(op, /* invert = */ true);
@@ -962,8 +1033,12 @@ LLValue *DtoArrayCompare(Loc &loc, TOK op, DValue *l, DValue *r) {
 
   if (!res) {
     Type *t = l->type->toBasetype()->nextOf()->toBasetype();
-    if (t->ty == Tchar) {
-      res = DtoArrayEqCmp_impl(loc, "_adCmpChar", l, r, false);
+    if (t->ty == Tchar || t->ty == Tuns8 || t->ty == Tbool || t->ty == Tvoid) {
+      // unsigned bytes are ordered like memcmp does
+      Type *commonType = t->arrayOf();
+      l = DtoCastArray(loc, l, commonType);
+      r = DtoCastArray(loc, r, commonType);
+      res = DtoArrayCompareBytes(loc, l, r);
     } else {
       res = DtoArrayEqCmp_impl(loc, "_adCmp2", l, r, true);
     }
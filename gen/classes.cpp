@@ -301,7 +301,10 @@ DValue *DtoCastClass(Loc &loc, DValue *val, Type *_to) {
 
 ////////////////////////////////////////////////////////////////////////////////
 
-DValue *DtoDynamicCastObject(Loc &loc, DValue *val, Type *_to) {
+namespace {
+/// Calls the runtime to cast the object reference obj to the class or
+/// interface cd, walking the ClassInfo hierarchy.
+LLValue *callDynamicCast(Loc &loc, LLValue *obj, ClassDeclaration *cd) {
   // call:
   // Object _d_dynamic_cast(Object o, ClassInfo c)
 
@@ -313,15 +316,12 @@ DValue *DtoDynamicCastObject(Loc &loc, DValue *val, Type *_to) {
   LLFunctionType *funcTy = func->getFunctionType();
 
   // Object o
-  LLValue *obj = DtoRVal(val);
   obj = DtoBitCast(obj, funcTy->getParamType(0));
   assert(funcTy->getParamType(0) == obj->getType());
 
   // ClassInfo c
-  TypeClass *to = static_cast<TypeClass *>(_to->toBasetype());
-  DtoResolveClass(to->sym);
-
-  LLValue *cinfo = getIrAggr(to->sym)->getClassInfoSymbol();
+  DtoResolveClass(cd);
+  LLValue *cinfo = getIrAggr(cd)->getClassInfoSymbol();
   // unfortunately this is needed as the implementation of object differs
   // somehow from the declaration
   // this could happen in user code as well :/
@@ -329,17 +329,12 @@ DValue *DtoDynamicCastObject(Loc &loc, DValue *val, Type *_to) {
   assert(funcTy->getParamType(1) == cinfo->getType());
 
   // call it
-  LLValue *ret = gIR->CreateCallOrInvoke(func, obj, cinfo).getInstruction();
-
-  // cast return value
-  ret = DtoBitCast(ret, DtoType(_to));
-
-  return new DImValue(_to, ret);
+  return gIR->CreateCallOrInvoke(func, obj, cinfo).getInstruction();
 }
 
-////////////////////////////////////////////////////////////////////////////////
-
-DValue *DtoDynamicCastInterface(Loc &loc, DValue *val, Type *_to) {
+/// Calls the runtime to cast the interface reference ptr to the class or
+/// interface cd.
+LLValue *callInterfaceCast(Loc &loc, LLValue *ptr, ClassDeclaration *cd) {
   // call:
   // Object _d_interface_cast(void* p, ClassInfo c)
 
@@ -351,20 +346,140 @@ DValue *DtoDynamicCastInterface(Loc &loc, DValue *val, Type *_to) {
   LLFunctionType *funcTy = func->getFunctionType();
 
   // void* p
-  LLValue *ptr = DtoRVal(val);
   ptr = DtoBitCast(ptr, funcTy->getParamType(0));
 
   // ClassInfo c
-  TypeClass *to = static_cast<TypeClass *>(_to->toBasetype());
-  DtoResolveClass(to->sym);
-  LLValue *cinfo = getIrAggr(to->sym)->getClassInfoSymbol();
+  DtoResolveClass(cd);
+  LLValue *cinfo = getIrAggr(cd)->getClassInfoSymbol();
   // unfortunately this is needed as the implementation of object differs
   // somehow from the declaration
   // this could happen in user code as well :/
   cinfo = DtoBitCast(cinfo, funcTy->getParamType(1));
 
   // call it
-  LLValue *ret = gIR->CreateCallOrInvoke(func, ptr, cinfo).getInstruction();
+  return gIR->CreateCallOrInvoke(func, ptr, cinfo).getInstruction();
+}
+
+/// Returns whether a dynamic cast to cd can be short-circuited by comparing
+/// the ClassInfo reference in the first vtbl slot of the object against the
+/// one of cd, i.e. whether cd is a D class objects can be instances of.
+bool hasExactClassCheck(ClassDeclaration *cd) {
+  return !cd->isInterfaceDeclaration() && !cd->cpp && !cd->isAbstract();
+}
+
+/// Given a non-null interface reference, returns the reference to the object
+/// it is part of. The first entry of each interface vtbl of a D class points
+/// to the corresponding Interface record in the ClassInfo, whose offset field
+/// is the distance from the start of the object.
+LLValue *interfaceToObject(LLValue *ptr) {
+  LLType *voidPtrTy = getVoidPtrType();
+  VarDeclaration *interfaces = Type::typeinfoclass->fields[3];
+  LLType *interfaceTy = DtoType(interfaces->type->nextOf());
+
+  LLValue *vtbl = DtoLoad(DtoBitCast(ptr, getPtrToType(getPtrToType(
+                              getPtrToType(interfaceTy)))),
+                          "itf.vtbl");
+  LLValue *info = DtoLoad(vtbl, "itf.info");
+  LLValue *offset = DtoLoad(DtoGEPi(info, 0, 2), "itf.offset");
+  LLValue *obj = DtoBitCast(ptr, voidPtrTy);
+  return gIR->ir->CreateGEP(obj, gIR->ir->CreateNeg(offset), "itf.object");
+}
+
+/// Emits a dynamic cast of val to the class cd with an inline check whether
+/// cd is the most-derived type of the object. For final classes, that check
+/// decides the cast on its own; otherwise, the runtime is only called if the
+/// check fails. Null references are forwarded without touching the runtime.
+DValue *emitDynamicCastWithFastPath(Loc &loc, DValue *val, Type *_to,
+                                    bool fromInterface) {
+  TypeClass *to = static_cast<TypeClass *>(_to->toBasetype());
+  ClassDeclaration *cd = to->sym;
+  const bool isFinal = (cd->storage_class & STCfinal) != 0;
+  IF_LOG Logger::println("inline %s ClassInfo check",
+                         isFinal ? "final" : "exact");
+
+  DtoResolveClass(cd);
+  LLType *toType = DtoType(_to);
+  LLValue *orig = DtoRVal(val);
+  LLValue *nullTo = LLConstant::getNullValue(toType);
+
+  llvm::BasicBlock *entrybb = gIR->scopebb();
+  llvm::BasicBlock *checkbb = gIR->insertBB("dyncast.check");
+  llvm::BasicBlock *slowbb =
+      isFinal ? nullptr : gIR->insertBBAfter(checkbb, "dyncast.slow");
+  llvm::BasicBlock *endbb =
+      gIR->insertBBAfter(isFinal ? checkbb : slowbb, "dyncast.end");
+
+  LLValue *isNull = gIR->ir->CreateICmpEQ(
+      orig, LLConstant::getNullValue(orig->getType()), ".nullcheck");
+  gIR->ir->CreateCondBr(isNull, endbb, checkbb);
+
+  // compare the ClassInfo in vtbl[0] of the object against the target's
+  gIR->scope() = IRScope(checkbb);
+  LLType *voidPtrTy = getVoidPtrType();
+  LLValue *obj = fromInterface ? interfaceToObject(orig) : orig;
+  LLValue *vtbl =
+      DtoLoad(DtoBitCast(obj, getPtrToType(getPtrToType(voidPtrTy))), "vtbl");
+  LLValue *objClassInfo = DtoLoad(vtbl, "classinfo");
+  LLValue *classInfo =
+      DtoBitCast(getIrAggr(cd)->getClassInfoSymbol(), voidPtrTy);
+  LLValue *isExact =
+      gIR->ir->CreateICmpEQ(objClassInfo, classInfo, ".exactcheck");
+  LLValue *exact = DtoBitCast(obj, toType);
+
+  LLValue *slow = nullptr;
+  llvm::BasicBlock *slowEndBB = nullptr;
+  if (isFinal) {
+    // nothing can derive from a final class
+    exact = gIR->ir->CreateSelect(isExact, exact, nullTo, ".dyncast");
+    gIR->ir->CreateBr(endbb);
+  } else {
+    gIR->ir->CreateCondBr(isExact, endbb, slowbb);
+
+    gIR->scope() = IRScope(slowbb);
+    slow = fromInterface ? callInterfaceCast(loc, orig, cd)
+                         : callDynamicCast(loc, orig, cd);
+    slow = DtoBitCast(slow, toType);
+    slowEndBB = gIR->scopebb();
+    gIR->ir->CreateBr(endbb);
+  }
+
+  gIR->scope() = IRScope(endbb);
+  llvm::PHINode *phi = gIR->ir->CreatePHI(toType, isFinal ? 2 : 3, ".dyncast");
+  phi->addIncoming(nullTo, entrybb);
+  phi->addIncoming(exact, checkbb);
+  if (slow) {
+    phi->addIncoming(slow, slowEndBB);
+  }
+
+  return new DImValue(_to, phi);
+}
+}
+
+DValue *DtoDynamicCastObject(Loc &loc, DValue *val, Type *_to) {
+  TypeClass *to = static_cast<TypeClass *>(_to->toBasetype());
+  if (hasExactClassCheck(to->sym)) {
+    return emitDynamicCastWithFastPath(loc, val, _to, false);
+  }
+
+  LLValue *ret = callDynamicCast(loc, DtoRVal(val), to->sym);
+
+  // cast return value
+  ret = DtoBitCast(ret, DtoType(_to));
+
+  return new DImValue(_to, ret);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+DValue *DtoDynamicCastInterface(Loc &loc, DValue *val, Type *_to) {
+  TypeClass *to = static_cast<TypeClass *>(_to->toBasetype());
+  // COM interface vtbls don't start with an Interface record
+  TypeClass *from = static_cast<TypeClass *>(val->type->toBasetype());
+  if (hasExactClassCheck(to->sym) && !from->sym->isCOMinterface()) {
+    return emitDynamicCastWithFastPath(loc, val, _to, true);
+  }
+
+  LLValue *ret = callInterfaceCast(loc, DtoRVal(val), to->sym);
 
   // cast return value
   ret = DtoBitCast(ret, DtoType(_to));
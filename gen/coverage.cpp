@@ -11,6 +11,7 @@
 
 #include "mars.h"
 #include "module.h"
+#include "driver/cl_options.h"
 #include "gen/irstate.h"
 #include "gen/logger.h"
 
@@ -29,6 +30,16 @@ void emitCoverageLinecountInc(Loc &loc) {
   IF_LOG Logger::println("Coverage: increment _d_cover_data[%d]", line);
   LOG_SCOPE;
 
+  using opts::CoverageIncrement;
+
+  // With -cov-increment=tls, count in the thread-local copy of _d_cover_data
+  // (see addCoverageAnalysis()).
+  llvm::GlobalVariable *data = gIR->dmodule->d_cover_data;
+  if (opts::coverageIncrement == CoverageIncrement::threadLocal) {
+    data = gIR->module.getGlobalVariable("_d_cover_data_tls", true);
+    assert(data && "thread-local coverage data not created");
+  }
+
   // Get GEP into _d_cover_data array
   LLConstant *idxs[] = {DtoConstUint(0), DtoConstUint(line)};
   LLValue *ptr = llvm::ConstantExpr::getGetElementPtr(
@@ -36,16 +47,39 @@ void emitCoverageLinecountInc(Loc &loc) {
       LLArrayType::get(LLType::getInt32Ty(gIR->context()),
                        gIR->dmodule->numlines),
 #endif
-      gIR->dmodule->d_cover_data, idxs, true);
+      data, idxs, true);
 
-  // Do an atomic increment, so this works when multiple threads are executed.
-  gIR->ir->CreateAtomicRMW(llvm::AtomicRMWInst::Add, ptr, DtoConstUint(1),
+  switch (opts::coverageIncrement) {
+  case CoverageIncrement::atomic:
+    // Do an atomic increment, so this works when multiple threads are
+    // executed.
+    gIR->ir->CreateAtomicRMW(llvm::AtomicRMWInst::Add, ptr, DtoConstUint(1),
 #if LDC_LLVM_VER >= 309
-                           llvm::AtomicOrdering::Monotonic
+                             llvm::AtomicOrdering::Monotonic
 #else
-                           llvm::Monotonic
+                             llvm::Monotonic
 #endif
-                           );
+                             );
+    break;
+  case CoverageIncrement::nonAtomic:
+  case CoverageIncrement::threadLocal: {
+    LLValue *count = gIR->ir->CreateLoad(ptr);
+    gIR->ir->CreateStore(gIR->ir->CreateAdd(count, DtoConstUint(1)), ptr);
+    break;
+  }
+  case CoverageIncrement::boolean: {
+    // All statements of a basic block are executed together, so the line only
+    // needs to be marked once per block.
+    for (auto &inst : *gIR->scopebb()) {
+      auto store = llvm::dyn_cast<llvm::StoreInst>(&inst);
+      if (store && store->getPointerOperand() == ptr) {
+        return;
+      }
+    }
+    gIR->ir->CreateStore(DtoConstUint(1), ptr);
+    break;
+  }
+  }
 
   unsigned num_sizet_bits = gDataLayout->getTypeSizeInBits(DtoSize_t());
   unsigned idx = line / num_sizet_bits;
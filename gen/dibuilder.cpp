@@ -74,7 +74,7 @@ Module *ldc::DIBuilder::getDefinedModule(Dsymbol *s) {
   }
   // array operations as well
   if (FuncDeclaration *fd = s->isFuncDeclaration()) {
-    if (fd->isArrayOp && (willInline() || !isDruntimeArrayOp(fd))) {
+    if (fd->isArrayOp && !useDruntimeArrayOp(fd)) {
       return IR->dmodule;
     }
   }
@@ -89,6 +89,10 @@ ldc::DIBuilder::DIBuilder(IRState *const IR)
 
 llvm::LLVMContext &ldc::DIBuilder::getContext() { return IR->context(); }
 
+bool ldc::DIBuilder::mustEmitFullDebugInfo() {
+  return global.params.symdebug && global.params.symdebug != 3;
+}
+
 ldc::DIScope ldc::DIBuilder::GetCurrentScope() {
   IrFunction *fn = IR->func();
   if (fn->diLexicalBlocks.empty()) {
@@ -557,8 +561,11 @@ ldc::DISubroutineType ldc::DIBuilder::CreateFunctionType(Type *type) {
   TypeFunction *t = static_cast<TypeFunction *>(type);
   Type *retType = t->next;
 
-  // Create "dummy" subroutine type for the return type
-  LLMetadata *params = {CreateTypeDescription(retType, true)};
+  // Create "dummy" subroutine type for the return type (left out for line
+  // tables only)
+  LLMetadata *params = {mustEmitFullDebugInfo()
+                            ? CreateTypeDescription(retType, true)
+                            : nullptr};
 #if LDC_LLVM_VER == 305
   auto paramsArray = DBuilder.getOrCreateArray(params);
 #else
@@ -680,6 +687,16 @@ void ldc::DIBuilder::EmitCompileUnit(Module *m) {
   IR->module.addModuleFlag(llvm::Module::Warning, "Debug Info Version",
                            llvm::DEBUG_METADATA_VERSION);
 
+#if LDC_LLVM_VER >= 309
+  const auto emissionKind = mustEmitFullDebugInfo()
+                                ? llvm::DICompileUnit::FullDebug
+                                : llvm::DICompileUnit::LineTablesOnly;
+#else
+  const auto emissionKind = mustEmitFullDebugInfo()
+                                ? llvm::DIBuilder::FullDebug
+                                : llvm::DIBuilder::LineTablesOnly;
+#endif
+
   CUNode = DBuilder.createCompileUnit(
       global.params.symdebug == 2 ? llvm::dwarf::DW_LANG_C
                                   : llvm::dwarf::DW_LANG_D,
@@ -687,7 +704,9 @@ void ldc::DIBuilder::EmitCompileUnit(Module *m) {
       "LDC (http://wiki.dlang.org/LDC)",
       isOptimizationEnabled(), // isOptimized
       llvm::StringRef(),       // Flags TODO
-      1                        // Runtime Version TODO
+      1,                       // Runtime Version TODO
+      llvm::StringRef(),       // SplitName
+      emissionKind             // DebugEmissionKind
       );
 }
 
@@ -954,7 +973,7 @@ void ldc::DIBuilder::EmitLocalVariable(llvm::Value *ll, VarDeclaration *vd,
                                        llvm::ArrayRef<llvm::Value *> addr
 #endif
                                        ) {
-  if (!global.params.symdebug)
+  if (!mustEmitFullDebugInfo())
     return;
 
   Logger::println("D to dwarf local variable");
@@ -1072,7 +1091,7 @@ void ldc::DIBuilder::EmitLocalVariable(llvm::Value *ll, VarDeclaration *vd,
 
 void ldc::DIBuilder::EmitGlobalVariable(llvm::GlobalVariable *llVar,
                                         VarDeclaration *vd) {
-  if (!global.params.symdebug)
+  if (!mustEmitFullDebugInfo())
     return;
 
   Logger::println("D to dwarf global_variable");
@@ -165,6 +165,9 @@ public:
 private:
   llvm::LLVMContext &getContext();
   Module *getDefinedModule(Dsymbol *s);
+  /// Whether variables and types are described, i.e. not just line tables
+  /// (-gline-tables-only).
+  bool mustEmitFullDebugInfo();
   DIScope GetCurrentScope();
   void Declare(const Loc &loc, llvm::Value *var, ldc::DILocalVariable divar
 #if LDC_LLVM_VER >= 306
@@ -18,6 +18,7 @@
 #include "mtype.h"
 #include "statement.h"
 #include "template.h"
+#include "driver/timetrace.h"
 #include "gen/abi.h"
 #include "gen/arrays.h"
 #include "gen/classes.h"
@@ -542,7 +543,10 @@ void DtoDeclareFunction(FuncDeclaration *fdecl) {
   if (fdecl->neverInline) {
     irFunc->setNeverInline();
   } else {
-    if (fdecl->inlining == PINLINEalways) {
+    // Generated array ops are always inlined when optimizing, so that their
+    // loops are vectorized for the target features of the caller (@target).
+    if (fdecl->inlining == PINLINEalways ||
+        (fdecl->isArrayOp && isOptimizationEnabled())) {
       irFunc->setAlwaysInline();
     } else if (fdecl->inlining == PINLINEnever) {
       irFunc->setNeverInline();
@@ -650,7 +654,7 @@ static LinkageWithCOMDAT lowerFuncLinkage(FuncDeclaration *fdecl) {
 
   // Generated array op functions behave like templates in that they might be
   // emitted into many different modules.
-  if (fdecl->isArrayOp && (willInline() || !isDruntimeArrayOp(fdecl))) {
+  if (fdecl->isArrayOp && !useDruntimeArrayOp(fdecl)) {
     return LinkageWithCOMDAT(templateLinkage, supportsCOMDAT());
   }
 
@@ -777,6 +781,9 @@ void DtoDefineFunction(FuncDeclaration *fd, bool linkageAvailableExternally) {
     fatal();
   }
 
+  TimeTraceScope timeScope("Codegen function",
+                           [fd] { return std::string(fd->toPrettyChars()); });
+
   DtoResolveFunction(fd);
 
   if (fd->isUnitTestDeclaration() && !global.params.useUnitTests) {
@@ -787,7 +794,7 @@ void DtoDefineFunction(FuncDeclaration *fd, bool linkageAvailableExternally) {
   }
 
   // Skip array ops implemented in druntime
-  if (fd->isArrayOp && !willInline() && isDruntimeArrayOp(fd)) {
+  if (fd->isArrayOp && useDruntimeArrayOp(fd)) {
     IF_LOG Logger::println(
         "No code generation for array op %s implemented in druntime",
         fd->toChars());
@@ -1103,6 +1110,13 @@ int binary(const char *p, const char **tab, int high) {
   return -1;
 }
 
+bool useDruntimeArrayOp(FuncDeclaration *fd) {
+  // The druntime implementations are opaque to the optimizer and only
+  // hand-vectorized for SSE2, so prefer the vectorizable generated loops
+  // when optimizing.
+  return !isOptimizationEnabled() && isDruntimeArrayOp(fd);
+}
+
 int isDruntimeArrayOp(FuncDeclaration *fd) {
   /* Some of the array op functions are written as library functions,
    * presumably to optimize them with special CPU vector instructions.
@@ -47,4 +47,8 @@ DValue *DtoArgument(Parameter *fnarg, Expression *argexp);
 // Search for a druntime array op
 int isDruntimeArrayOp(FuncDeclaration *fd);
 
+// Whether the druntime implementation of an array op is used instead of the
+// frontend-generated function
+bool useDruntimeArrayOp(FuncDeclaration *fd);
+
 #endif
@@ -30,6 +30,9 @@ enum TypeDataFields {
 
   TD_Type, /// A value of the LLVM type corresponding to this D type
 
+  TD_ElemInit, /// For dynamic arrays of scalars with a non-zero default
+               /// initializer, the element initializer (null otherwise).
+
   // Must be kept last:
   TD_NumFields /// The number of fields in TypeInfo metadata
 };
@@ -22,6 +22,7 @@
 #include "statement.h"
 #include "target.h"
 #include "template.h"
+#include "driver/cl_options.h"
 #include "gen/abi.h"
 #include "gen/arrays.h"
 #include "gen/functions.h"
@@ -409,6 +410,88 @@ void build_llvm_used_array(IRState *p) {
   llvmUsed->setSection("llvm.metadata");
 }
 
+// Creates the thread-local _d_cover_data_tls and the thread destructor adding
+// it to _d_cover_data.
+static void addThreadLocalCoverageData(Module *m) {
+  LLArrayType *type =
+      LLArrayType::get(LLType::getInt32Ty(gIR->context()), m->numlines);
+  llvm::GlobalVariable *tlsData = getOrCreateGlobal(
+      Loc(), gIR->module, type, false, LLGlobalValue::InternalLinkage,
+      llvm::ConstantAggregateZero::get(type), "_d_cover_data_tls", true);
+
+  std::string dtorname = "_D";
+  dtorname += mangle(m);
+  dtorname += "12_coverageanalysisDtor1FZv";
+  IF_LOG Logger::println("Build Coverage Analysis thread destructor: %s",
+                         dtorname.c_str());
+
+  LLFunctionType *dtorTy = LLFunctionType::get(
+      LLType::getVoidTy(gIR->context()), std::vector<LLType *>(), false);
+  LLFunction *dtor = LLFunction::Create(dtorTy, LLGlobalValue::InternalLinkage,
+                                        dtorname, &gIR->module);
+  dtor->setCallingConv(gABI->callingConv(dtor->getFunctionType(), LINKd));
+
+  llvm::BasicBlock *entrybb =
+      llvm::BasicBlock::Create(gIR->context(), "", dtor);
+  llvm::BasicBlock *loopbb =
+      llvm::BasicBlock::Create(gIR->context(), "merge", dtor);
+  llvm::BasicBlock *addbb =
+      llvm::BasicBlock::Create(gIR->context(), "merge.add", dtor);
+  llvm::BasicBlock *nextbb =
+      llvm::BasicBlock::Create(gIR->context(), "merge.next", dtor);
+  llvm::BasicBlock *endbb =
+      llvm::BasicBlock::Create(gIR->context(), "merge.end", dtor);
+  IRBuilder<> builder(entrybb);
+  builder.CreateBr(loopbb);
+
+  // for (i = 0; i < numlines; ++i)
+  //   if (tlsData[i]) { atomic _d_cover_data[i] += tlsData[i]; tlsData[i] = 0; }
+  builder.SetInsertPoint(loopbb);
+  llvm::PHINode *i = builder.CreatePHI(DtoSize_t(), 2, "i");
+  i->addIncoming(DtoConstSize_t(0), entrybb);
+  LLValue *tlsPtr = builder.CreateInBoundsGEP(
+#if LDC_LLVM_VER >= 307
+      type,
+#endif
+      tlsData, {DtoConstSize_t(0), i});
+  LLValue *count = builder.CreateLoad(tlsPtr);
+  builder.CreateCondBr(builder.CreateIsNotNull(count), addbb, nextbb);
+
+  builder.SetInsertPoint(addbb);
+  LLValue *dataPtr = builder.CreateInBoundsGEP(
+#if LDC_LLVM_VER >= 307
+      type,
+#endif
+      m->d_cover_data, {DtoConstSize_t(0), i});
+  builder.CreateAtomicRMW(llvm::AtomicRMWInst::Add, dataPtr, count,
+#if LDC_LLVM_VER >= 309
+                          llvm::AtomicOrdering::Monotonic
+#else
+                          llvm::Monotonic
+#endif
+                          );
+  builder.CreateStore(DtoConstUint(0), tlsPtr);
+  builder.CreateBr(nextbb);
+
+  builder.SetInsertPoint(nextbb);
+  LLValue *next = builder.CreateAdd(i, DtoConstSize_t(1));
+  i->addIncoming(next, nextbb);
+  builder.CreateCondBr(
+      builder.CreateICmpULT(next, DtoConstSize_t(m->numlines)), loopbb, endbb);
+
+  builder.SetInsertPoint(endbb);
+  builder.CreateRetVoid();
+
+  // Add the dtor to the module's (thread-local) static destructors, like the
+  // constructor in addCoverageAnalysis().
+  FuncDeclaration *fd =
+      FuncDeclaration::genCfunc(nullptr, Type::tvoid, dtorname.c_str());
+  fd->linkage = LINKd;
+  IrFunction *irfunc = getIrFunc(fd, true);
+  irfunc->func = dtor;
+  getIrModule(m)->dtors.push_back(fd);
+}
+
 // Add module-private variables and functions for coverage analysis.
 void addCoverageAnalysis(Module *m) {
   IF_LOG {
@@ -478,6 +561,14 @@ void addCoverageAnalysis(Module *m) {
                           m->d_cover_data, idxs, true));
   }
 
+  // With -cov-increment=tls, lines are counted in a thread-local copy of
+  // _d_cover_data without any synchronization. A module thread destructor adds
+  // the counts to _d_cover_data when the thread exits.
+  if (opts::coverageIncrement == opts::CoverageIncrement::threadLocal &&
+      m->numlines > 0) {
+    addThreadLocalCoverageData(m);
+  }
+
   // Create "static constructor" that calls _d_cover_register2(string filename,
   // size_t[] valid, uint[] data, ubyte minPercent)
   // Build ctor name
@@ -9,6 +9,8 @@
 
 #include "gen/optimizer.h"
 #include "errors.h"
+#include "driver/timetrace.h"
+#include "driver/toobj.h"
 #include "gen/cl_helpers.h"
 #include "gen/logger.h"
 #include "gen/passes/Passes.h"
@@ -37,7 +39,6 @@
 #include "llvm/Transforms/IPO.h"
 #include "llvm/Transforms/IPO/PassManagerBuilder.h"
 
-extern llvm::TargetMachine *gTargetMachine;
 using namespace llvm;
 
 static cl::opt<signed char> optimizeLevel(
@@ -84,6 +85,11 @@ static cl::opt<bool> disableGCToStack(
     cl::desc("Disable promotion of GC allocations to stack memory"),
     cl::ZeroOrMore);
 
+static cl::opt<bool> disableBoundsCheckElim(
+    "disable-boundscheck-elim",
+    cl::desc("Disable removal and loop hoisting of array bounds checks"),
+    cl::ZeroOrMore);
+
 static cl::opt<cl::boolOrDefault, false, opts::FlagParser<cl::boolOrDefault>>
     enableInlining(
         "inlining",
@@ -113,6 +119,12 @@ cl::opt<opts::SanitizerCheck> opts::sanitize(
                clEnumValN(opts::ThreadSanitizer, "thread", "race detection"),
                clEnumValEnd));
 
+cl::opt<std::string> opts::sampleProfileFile(
+    "fprofile-sample-use", cl::value_desc("filename"),
+    cl::desc("Use sample profile data (e.g. converted from perf) for "
+             "profile-guided optimization"),
+    cl::ValueRequired);
+
 static cl::opt<bool> disableLoopUnrolling(
     "disable-loop-unrolling",
     cl::desc("Disable loop unrolling in all relevant passes"), cl::init(false));
@@ -194,6 +206,13 @@ static void addGarbageCollect2StackPass(const PassManagerBuilder &builder,
   }
 }
 
+static void addBoundsCheckEliminationPass(const PassManagerBuilder &builder,
+                                          PassManagerBase &pm) {
+  if (builder.OptLevel >= 2 && builder.SizeLevel == 0) {
+    addPass(pm, createBoundsCheckElimination());
+  }
+}
+
 static void addAddressSanitizerPasses(const PassManagerBuilder &Builder,
                                       PassManagerBase &PM) {
   PM.add(createAddressSanitizerFunctionPass());
@@ -222,6 +241,11 @@ static void addThreadSanitizerPass(const PassManagerBuilder &Builder,
   PM.add(createThreadSanitizerPass());
 }
 
+static void addAddDiscriminatorsPass(const PassManagerBuilder &builder,
+                                     PassManagerBase &pm) {
+  pm.add(createAddDiscriminatorsPass());
+}
+
 static void addInstrProfilingPass(legacy::PassManagerBase &mpm) {
 #if LDC_WITH_PGO
   if (global.params.genInstrProf) {
@@ -329,6 +353,13 @@ static void addOptimizationPasses(PassManagerBase &mpm,
       builder.addExtension(PassManagerBuilder::EP_LoopOptimizerEnd,
                            addGarbageCollect2StackPass);
     }
+
+    // Needs to run before loop unswitching to enable check-free loop
+    // versions.
+    if (!disableBoundsCheckElim) {
+      builder.addExtension(PassManagerBuilder::EP_Peephole,
+                           addBoundsCheckEliminationPass);
+    }
   }
 
   // EP_OptimizerLast does not exist in LLVM 3.0, add it manually below.
@@ -337,6 +368,14 @@ static void addOptimizationPasses(PassManagerBase &mpm,
 
   addInstrProfilingPass(mpm);
 
+  // Samples are attributed to the code via the debug line locations, with
+  // discriminators telling apart the basic blocks of a single line.
+  if (!opts::sampleProfileFile.empty()) {
+    builder.addExtension(PassManagerBuilder::EP_EarlyAsPossible,
+                         addAddDiscriminatorsPass);
+    mpm.add(createSampleProfileLoaderPass(opts::sampleProfileFile));
+  }
+
   builder.populateFunctionPassManager(fpm);
   builder.populateModulePassManager(mpm);
 }
@@ -344,7 +383,11 @@ static void addOptimizationPasses(PassManagerBase &mpm,
 ////////////////////////////////////////////////////////////////////////////////
 // This function runs optimization passes based on command line arguments.
 // Returns true if any optimization passes were invoked.
-bool ldc_optimize_module(llvm::Module *M) {
+bool ldc_optimize_module(llvm::Module *M, llvm::TargetMachine &target) {
+  TimeTraceScope timeScope("Optimize module", [M] {
+    return M->getModuleIdentifier();
+  });
+
 // Create a PassManager to hold and optimize the collection of
 // per-module passes we are about to build.
 #if LDC_LLVM_VER >= 307
@@ -392,10 +435,10 @@ bool ldc_optimize_module(llvm::Module *M) {
 #if LDC_LLVM_VER >= 307
   // Add internal analysis passes from the target machine.
   mpm.add(createTargetTransformInfoWrapperPass(
-      gTargetMachine->getTargetIRAnalysis()));
+      target.getTargetIRAnalysis()));
 #else
   // Add internal analysis passes from the target machine.
-  gTargetMachine->addAnalysisPasses(mpm);
+  target.addAnalysisPasses(mpm);
 #endif
 
 // Also set up a manager for the per-function passes.
@@ -407,13 +450,13 @@ bool ldc_optimize_module(llvm::Module *M) {
 #if LDC_LLVM_VER >= 307
   // Add internal analysis passes from the target machine.
   fpm.add(createTargetTransformInfoWrapperPass(
-      gTargetMachine->getTargetIRAnalysis()));
+      target.getTargetIRAnalysis()));
 #elif LDC_LLVM_VER >= 306
   fpm.add(new DataLayoutPass());
-  gTargetMachine->addAnalysisPasses(fpm);
+  target.addAnalysisPasses(fpm);
 #else
                                     fpm.add(new DataLayoutPass(M));
-                                    gTargetMachine->addAnalysisPasses(fpm);
+                                    target.addAnalysisPasses(fpm);
 #endif
 
   // If the -strip-debug command line option was specified, add it before
@@ -425,17 +468,26 @@ bool ldc_optimize_module(llvm::Module *M) {
   addOptimizationPasses(mpm, fpm, optLevel(), sizeLevel());
 
   // Run per-function passes.
-  fpm.doInitialization();
-  for (auto &F : *M) {
-    fpm.run(F);
+  {
+    TimeTraceScope passesScope("Function passes");
+    fpm.doInitialization();
+    for (auto &F : *M) {
+      TimeTraceScope functionScope("Optimize function",
+                                   [&F] { return F.getName().str(); });
+      fpm.run(F);
+    }
+    fpm.doFinalization();
   }
-  fpm.doFinalization();
 
   // Run per-module passes.
-  mpm.run(*M);
+  {
+    TimeTraceScope passesScope("Module passes");
+    mpm.run(*M);
+  }
 
   // Verify the resulting module.
   if (!noVerify) {
+    TimeTraceScope verifyScope("Verify module");
     verifyModule(M);
   }
 
@@ -450,8 +502,9 @@ void verifyModule(llvm::Module *m) {
   std::string ErrorStr;
   raw_string_ostream OS(ErrorStr);
   if (llvm::verifyModule(*m, &OS)) {
-    error(Loc(), "%s", ErrorStr.c_str());
-    fatal();
+    // This may run on a backend thread (-threads).
+    backendError("%s", OS.str().c_str());
+    return;
   }
   Logger::println("Verification passed!");
 }
@@ -30,13 +30,16 @@ enum SanitizerCheck {
 };
 
 extern llvm::cl::opt<SanitizerCheck> sanitize;
+
+extern llvm::cl::opt<std::string> sampleProfileFile;
 }
 
 namespace llvm {
 class Module;
+class TargetMachine;
 }
 
-bool ldc_optimize_module(llvm::Module *m);
+bool ldc_optimize_module(llvm::Module *m, llvm::TargetMachine &target);
 
 // Returns whether the normal, full inlining pass will be run.
 bool willInline();
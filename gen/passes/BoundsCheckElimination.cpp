@@ -0,0 +1,376 @@
+//===-- BoundsCheckElimination.cpp - Remove and hoist array bounds checks -===//
+//
+//                         LDC – the LLVM D compiler
+//
+// This file is distributed under the BSD-style LDC license. See the LICENSE
+// file for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements a pass recognizing the array bounds checks emitted by
+// the frontend (an unsigned index < length comparison branching to a call to
+// _d_arraybounds) and
+//  - removes checks implied by a dominating check of the same array length,
+//  - guards checks of affine loop indices by a single loop-invariant range
+//    check, so that loop unswitching can create a check-free (and hence
+//    vectorizable) version of the loop.
+//
+//===----------------------------------------------------------------------===//
+
+#define DEBUG_TYPE "dboundscheck"
+
+#include "Passes.h"
+
+#include "llvm/Pass.h"
+#include "llvm/IR/CallSite.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/DataLayout.h"
+#include "llvm/IR/Dominators.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/IntrinsicInst.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Analysis/LoopInfo.h"
+#include "llvm/Analysis/ScalarEvolution.h"
+#include "llvm/Analysis/ScalarEvolutionExpander.h"
+#include "llvm/Analysis/ScalarEvolutionExpressions.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/Support/Compiler.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Support/raw_ostream.h"
+
+using namespace llvm;
+
+STATISTIC(NumRedundant, "Number of bounds checks removed as redundant");
+STATISTIC(NumHoisted, "Number of bounds checks guarded by a loop range check");
+
+#if LDC_LLVM_VER >= 308
+typedef ScalarEvolutionWrapperPass ScalarEvolutionPass;
+#else
+typedef ScalarEvolution ScalarEvolutionPass;
+#endif
+#if LDC_LLVM_VER >= 307
+typedef LoopInfoWrapperPass LoopInfoPass;
+#else
+typedef LoopInfo LoopInfoPass;
+#endif
+
+/// Metadata kind marking checks already guarded by a range check, so that
+/// they aren't hoisted again after the loop has been unswitched.
+static const char *const HoistedMDName = "ldc.boundscheck.hoisted";
+
+namespace {
+/// A bounds check `Index <u Length` branching to the failure block otherwise.
+struct BoundsCheck {
+  BranchInst *Br;
+  Value *Index;
+  Value *Length;
+  BasicBlock *OkBB;
+  BasicBlock *FailBB;
+  /// Whether the branch condition is true if the check fails.
+  bool FailOnTrue;
+};
+
+/// Returns whether BB reports a bounds check failure.
+bool isBoundsFailBlock(BasicBlock *BB) {
+  for (auto &I : *BB) {
+    CallSite CS(&I);
+    if (!CS.getInstruction() || isa<DbgInfoIntrinsic>(&I)) {
+      continue;
+    }
+    Function *Callee = CS.getCalledFunction();
+    return Callee && Callee->getName() == "_d_arraybounds";
+  }
+  return false;
+}
+
+/// Matches the (possibly canonicalized) bounds check terminating BB.
+bool matchBoundsCheck(BasicBlock &BB, BoundsCheck &Check) {
+  auto Br = dyn_cast<BranchInst>(BB.getTerminator());
+  if (!Br || !Br->isConditional()) {
+    return false;
+  }
+  auto Cmp = dyn_cast<ICmpInst>(Br->getCondition());
+  if (!Cmp) {
+    return false;
+  }
+
+  Check.Br = Br;
+  Check.FailOnTrue = isBoundsFailBlock(Br->getSuccessor(0));
+  if (!Check.FailOnTrue && !isBoundsFailBlock(Br->getSuccessor(1))) {
+    return false;
+  }
+  Check.OkBB = Br->getSuccessor(Check.FailOnTrue ? 1 : 0);
+  Check.FailBB = Br->getSuccessor(Check.FailOnTrue ? 0 : 1);
+
+  // Normalize to `Index <u Length` (or `Index >=u Length` for FailOnTrue).
+  ICmpInst::Predicate Pred = Cmp->getPredicate();
+  Value *LHS = Cmp->getOperand(0);
+  Value *RHS = Cmp->getOperand(1);
+  if (Pred == ICmpInst::ICMP_UGT || Pred == ICmpInst::ICMP_ULE) {
+    Pred = ICmpInst::getSwappedPredicate(Pred);
+    std::swap(LHS, RHS);
+  }
+  if (Pred != (Check.FailOnTrue ? ICmpInst::ICMP_UGE : ICmpInst::ICMP_ULT)) {
+    return false;
+  }
+  Check.Index = LHS;
+  Check.Length = RHS;
+  return true;
+}
+
+/// Makes the check always succeed; the failure path is cleaned up by
+/// SimplifyCFG later on, keeping the dominator tree valid meanwhile.
+void removeCheck(const BoundsCheck &Check) {
+  LLVMContext &Ctx = Check.Br->getContext();
+  Check.Br->setCondition(Check.FailOnTrue ? ConstantInt::getFalse(Ctx)
+                                          : ConstantInt::getTrue(Ctx));
+}
+
+/// Returns whether a successful check of DomIndex implies Index being in
+/// bounds for the same length.
+bool isImpliedIndex(Value *Index, Value *DomIndex) {
+  if (Index == DomIndex) {
+    return true;
+  }
+  auto C = dyn_cast<ConstantInt>(Index);
+  auto DomC = dyn_cast<ConstantInt>(DomIndex);
+  return C && DomC && C->getValue().ule(DomC->getValue());
+}
+
+/// Returns an upper bound for the number of times the backedge of L is taken.
+///
+/// The bounds checks in the loop are exits themselves (to their failure
+/// blocks), with exit counts depending on the array length. Hence the
+/// backedge-taken count of the whole loop is usually not computable, and the
+/// exit count of one of the loop's own exits is used instead: the other exits
+/// can only leave the loop earlier. Only exits dominating the latch are
+/// considered, as the others may be bypassed.
+const SCEV *getLoopExitCountBound(Loop *L, ScalarEvolution &SE,
+                                  DominatorTree &DT) {
+  BasicBlock *Latch = L->getLoopLatch();
+  if (!Latch) {
+    return SE.getCouldNotCompute();
+  }
+
+  SmallVector<BasicBlock *, 8> ExitingBlocks;
+  L->getExitingBlocks(ExitingBlocks);
+  for (BasicBlock *ExitingBB : ExitingBlocks) {
+    bool IsBoundsCheck = true;
+    auto Term = ExitingBB->getTerminator();
+    for (unsigned I = 0, E = Term->getNumSuccessors(); I != E; ++I) {
+      BasicBlock *Succ = Term->getSuccessor(I);
+      if (!L->contains(Succ) && !isBoundsFailBlock(Succ)) {
+        IsBoundsCheck = false;
+      }
+    }
+    if (IsBoundsCheck || !DT.dominates(ExitingBB, Latch)) {
+      continue;
+    }
+
+    const SCEV *ExitCount = SE.getExitCount(L, ExitingBB);
+    if (!isa<SCEVCouldNotCompute>(ExitCount)) {
+      return ExitCount;
+    }
+  }
+  return SE.getCouldNotCompute();
+}
+
+class LLVM_LIBRARY_VISIBILITY BoundsCheckElimination : public FunctionPass {
+public:
+  static char ID; // Pass identification
+  BoundsCheckElimination() : FunctionPass(ID) {}
+
+  bool runOnFunction(Function &F) override;
+
+  void getAnalysisUsage(AnalysisUsage &AU) const override {
+#if LDC_LLVM_VER < 307
+    AU.addRequired<DataLayoutPass>();
+#endif
+    AU.addRequired<DominatorTreeWrapperPass>();
+    AU.addRequired<LoopInfoPass>();
+    AU.addRequired<ScalarEvolutionPass>();
+  }
+
+private:
+  bool removeRedundantChecks(SmallVectorImpl<BoundsCheck> &Checks,
+                             DominatorTree &DT);
+  bool hoistLoopChecks(ArrayRef<BoundsCheck> Checks, LoopInfo &LI,
+                       ScalarEvolution &SE, DominatorTree &DT,
+                       const DataLayout &DL);
+};
+char BoundsCheckElimination::ID = 0;
+} // end anonymous namespace.
+
+static RegisterPass<BoundsCheckElimination>
+    X("dboundscheck-elim", "Remove and hoist D array bounds checks");
+
+// Public interface to the pass.
+FunctionPass *createBoundsCheckElimination() {
+  return new BoundsCheckElimination();
+}
+
+bool BoundsCheckElimination::runOnFunction(Function &F) {
+  SmallVector<BoundsCheck, 16> Checks;
+  for (auto &BB : F) {
+    BoundsCheck Check;
+    if (matchBoundsCheck(BB, Check)) {
+      Checks.push_back(Check);
+    }
+  }
+  if (Checks.empty()) {
+    return false;
+  }
+
+  DEBUG(errs() << "\nRunning -dboundscheck-elim on function " << F.getName()
+               << " (" << Checks.size() << " checks)\n");
+
+#if LDC_LLVM_VER >= 307
+  const DataLayout &DL = F.getParent()->getDataLayout();
+  LoopInfo &LI = getAnalysis<LoopInfoPass>().getLoopInfo();
+#else
+  const DataLayout &DL = getAnalysis<DataLayoutPass>().getDataLayout();
+  LoopInfo &LI = getAnalysis<LoopInfoPass>();
+#endif
+#if LDC_LLVM_VER >= 308
+  ScalarEvolution &SE = getAnalysis<ScalarEvolutionPass>().getSE();
+#else
+  ScalarEvolution &SE = getAnalysis<ScalarEvolutionPass>();
+#endif
+  DominatorTree &DT = getAnalysis<DominatorTreeWrapperPass>().getDomTree();
+
+  bool Changed = removeRedundantChecks(Checks, DT);
+  Changed |= hoistLoopChecks(Checks, LI, SE, DT, DL);
+  return Changed;
+}
+
+/// Removes the checks implied by a check on a dominating edge. The removed
+/// checks are erased from Checks.
+bool BoundsCheckElimination::removeRedundantChecks(
+    SmallVectorImpl<BoundsCheck> &Checks, DominatorTree &DT) {
+  DenseMap<Value *, SmallVector<const BoundsCheck *, 4>> ByLength;
+  for (const auto &Check : Checks) {
+    ByLength[Check.Length].push_back(&Check);
+  }
+
+  SmallVector<BoundsCheck, 16> Remaining;
+  for (const auto &Check : Checks) {
+    BasicBlock *BB = Check.Br->getParent();
+    bool Redundant = false;
+    for (const BoundsCheck *Dom : ByLength[Check.Length]) {
+      if (Dom == &Check || !isImpliedIndex(Check.Index, Dom->Index)) {
+        continue;
+      }
+      BasicBlockEdge OkEdge(Dom->Br->getParent(), Dom->OkBB);
+      if (DT.dominates(OkEdge, BB)) {
+        Redundant = true;
+        break;
+      }
+    }
+
+    if (Redundant) {
+      DEBUG(errs() << "Redundant check in " << BB->getName() << '\n');
+      removeCheck(Check);
+      ++NumRedundant;
+    } else {
+      Remaining.push_back(Check);
+    }
+  }
+
+  const bool Changed = Remaining.size() != Checks.size();
+  Checks.swap(Remaining);
+  return Changed;
+}
+
+/// Guards the checks of affine indices with a unit stride in loops with a
+/// computable trip count by a range check in the loop preheader, making them
+/// `RangeOk || Index <u Length`. If RangeOk holds, none of the checks in the
+/// loop can fail, so the unswitched loop doesn't need any.
+bool BoundsCheckElimination::hoistLoopChecks(ArrayRef<BoundsCheck> Checks,
+                                             LoopInfo &LI, ScalarEvolution &SE,
+                                             DominatorTree &DT,
+                                             const DataLayout &DL) {
+  bool Changed = false;
+#if LDC_LLVM_VER >= 307
+  SCEVExpander Expander(SE, DL, "bounds");
+#else
+  SCEVExpander Expander(SE, "bounds");
+#endif
+
+  for (const auto &Check : Checks) {
+    if (Check.Br->getMetadata(HoistedMDName)) {
+      continue;
+    }
+
+    Loop *L = LI.getLoopFor(Check.Br->getParent());
+    if (!L || !L->isLoopInvariant(Check.Length)) {
+      continue;
+    }
+    BasicBlock *Preheader = L->getLoopPreheader();
+    if (!Preheader || !SE.isSCEVable(Check.Index->getType())) {
+      continue;
+    }
+
+    auto AR = dyn_cast<SCEVAddRecExpr>(SE.getSCEV(Check.Index));
+    if (!AR || AR->getLoop() != L || !AR->isAffine()) {
+      continue;
+    }
+    auto Step = dyn_cast<SCEVConstant>(AR->getStepRecurrence(SE));
+    if (!Step) {
+      continue;
+    }
+    const bool Increasing = Step->getValue()->isOne();
+    if (!Increasing && !Step->getValue()->isAllOnesValue()) {
+      continue;
+    }
+
+    // The index takes (at most) the values Start .. Start ± BTC.
+    const SCEV *BTC = getLoopExitCountBound(L, SE, DT);
+    Type *IndexTy = Check.Index->getType();
+    if (isa<SCEVCouldNotCompute>(BTC) ||
+        SE.getTypeSizeInBits(BTC->getType()) >
+            SE.getTypeSizeInBits(IndexTy)) {
+      continue;
+    }
+    BTC = SE.getZeroExtendExpr(BTC, IndexTy);
+    const SCEV *Start = AR->getStart();
+    const SCEV *Last = Increasing ? SE.getAddExpr(Start, BTC)
+                                  : SE.getMinusSCEV(Start, BTC);
+    if (!isSafeToExpand(Start, SE) || !isSafeToExpand(Last, SE)) {
+      continue;
+    }
+
+    DEBUG(errs() << "Hoisting check in " << Check.Br->getParent()->getName()
+                 << " to " << Preheader->getName() << '\n');
+
+    Instruction *InsertPt = Preheader->getTerminator();
+    Value *StartV = Expander.expandCodeFor(Start, IndexTy, InsertPt);
+    Value *LastV = Expander.expandCodeFor(Last, IndexTy, InsertPt);
+
+    // Both ends are in bounds and the index doesn't wrap around in between.
+    IRBuilder<> B(InsertPt);
+    Value *RangeOk = B.CreateAnd(
+        B.CreateICmpULT(StartV, Check.Length, "bounds.start"),
+        B.CreateICmpULT(LastV, Check.Length, "bounds.last"));
+    RangeOk = B.CreateAnd(RangeOk, Increasing
+                                       ? B.CreateICmpULE(StartV, LastV)
+                                       : B.CreateICmpULE(LastV, StartV),
+                          "bounds.range");
+
+    B.SetInsertPoint(Check.Br);
+    Value *Cond = Check.Br->getCondition();
+    Check.Br->setCondition(
+        Check.FailOnTrue ? B.CreateAnd(B.CreateNot(RangeOk), Cond)
+                         : B.CreateOr(RangeOk, Cond));
+    Check.Br->setMetadata(HoistedMDName,
+                          MDNode::get(Check.Br->getContext(), None));
+
+    ++NumHoisted;
+    Changed = true;
+  }
+
+  return Changed;
+}
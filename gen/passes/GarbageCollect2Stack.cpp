@@ -31,6 +31,7 @@
 #include "llvm/Analysis/CallGraph.h"
 #include "llvm/IR/Dominators.h"
 #include "llvm/Analysis/ValueTracking.h"
+#include "llvm/Transforms/Utils/BasicBlockUtils.h"
 #include "llvm/ADT/SmallSet.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/StringMap.h"
@@ -47,6 +48,9 @@ using namespace llvm;
 STATISTIC(NumGcToStack, "Number of calls promoted to constant-size allocas");
 STATISTIC(NumToDynSize,
           "Number of calls promoted to dynamically-sized allocas");
+STATISTIC(NumSizeChecked,
+          "Number of calls promoted to stack buffers if small enough at "
+          "runtime");
 STATISTIC(NumDeleted,
           "Number of GC calls deleted because the return value was unused");
 
@@ -63,6 +67,10 @@ struct Analysis {
   CallGraphNode *CGNode;
 
   Type *getTypeFor(Value *typeinfo) const;
+  Constant *getElemInitFor(Value *typeinfo) const;
+
+private:
+  MDNode *getTypeMetadata(Value *typeinfo) const;
 };
 }
 
@@ -82,11 +90,6 @@ void EmitMemSet(IRBuilder<> &B, Value *Dst, Value *Val, Value *Len,
   }
 }
 
-static void EmitMemZero(IRBuilder<> &B, Value *Dst, Value *Len,
-                        const Analysis &A) {
-  EmitMemSet(B, Dst, ConstantInt::get(B.getInt8Ty(), 0), Len, A);
-}
-
 //===----------------------------------------------------------------------===//
 // Helpers for specific types of GC calls.
 //===----------------------------------------------------------------------===//
@@ -103,9 +106,25 @@ class FunctionInfo {
 protected:
   Type *Ty;
 
+  // For allocations of a size only known at runtime: the number of elements
+  // of type Ty allocated, and the maximum number to put on the stack.
+  Value *Count;
+  uint64_t CountLimit;
+
+  // Turns the stack memory Mem (a Ty*) into the value replacing the call,
+  // initializing it if needed.
+  virtual Value *finishStackMemory(CallSite CS, IRBuilder<> &B, Value *Mem,
+                                   const Analysis &A) {
+    return Mem;
+  }
+
 public:
   ReturnType::Type ReturnType;
 
+  // Set by analyze() if the allocation might exceed the size limit at
+  // runtime. Such calls need to be promoted using promoteSizeChecked().
+  bool NeedsSizeCheck = false;
+
   // Analyze the current call, filling in some fields. Returns true if
   // this is an allocation we can stack-allocate.
   virtual bool analyze(CallSite CS, const Analysis &A) = 0;
@@ -119,10 +138,53 @@ public:
     return new AllocaInst(Ty, ".nongc_mem", Begin); // FIXME: align?
   }
 
+  // Replaces the uses of the call by a fixed-size stack buffer if Count turns
+  // out to be small enough at runtime, keeping the GC allocation otherwise.
+  // This changes the CFG.
+  void promoteSizeChecked(CallInst *CI, const Analysis &A);
+
   explicit FunctionInfo(ReturnType::Type returnType) : ReturnType(returnType) {}
   virtual ~FunctionInfo() = default;
 };
 
+void FunctionInfo::promoteSizeChecked(CallInst *CI, const Analysis &A) {
+  NumSizeChecked++;
+
+  // Reserve the buffer in the entry block, so that the stack does not grow if
+  // the allocation is executed in a loop.
+  BasicBlock &Entry = CI->getParent()->getParent()->getEntryBlock();
+  AllocaInst *Buf = new AllocaInst(ArrayType::get(Ty, CountLimit),
+                                   ".nongc_buf", &(*Entry.begin()));
+  // Match the alignment guaranteed by the GC.
+  Buf->setAlignment(16);
+
+  // The runtime returns null for empty allocations, so leave those to it:
+  // Count - 1 wraps around for a Count of 0.
+  IRBuilder<> B(CI);
+  IntegerType *CountTy = cast<IntegerType>(Count->getType());
+  Value *Fits = B.CreateICmpULT(
+      B.CreateSub(Count, ConstantInt::get(CountTy, 1)),
+      ConstantInt::get(CountTy, CountLimit - 1), ".fits_on_stack");
+
+  TerminatorInst *ThenTerm, *ElseTerm;
+  SplitBlockAndInsertIfThenElse(Fits, CI, &ThenTerm, &ElseTerm);
+  BasicBlock *Tail = CI->getParent();
+  CI->moveBefore(ElseTerm);
+
+  B.SetInsertPoint(ThenTerm);
+  Value *Mem = B.CreateBitCast(Buf, PointerType::getUnqual(Ty));
+  Value *StackVal = finishStackMemory(CI, B, Mem, A);
+  if (StackVal->getType() != CI->getType()) {
+    StackVal = B.CreateBitCast(StackVal, CI->getType());
+  }
+
+  PHINode *Phi = PHINode::Create(CI->getType(), 2, "", &Tail->front());
+  CI->replaceAllUsesWith(Phi);
+  Phi->takeName(CI);
+  Phi->addIncoming(StackVal, ThenTerm->getParent());
+  Phi->addIncoming(CI, ElseTerm->getParent());
+}
+
 static bool isKnownLessThan(Value *Val, uint64_t Limit, const Analysis &A) {
   unsigned BitsLimit = Log2_64(Limit);
 
@@ -154,6 +216,7 @@ static bool isKnownLessThan(Value *Val, uint64_t Limit, const Analysis &A) {
 }
 
 class TypeInfoFI : public FunctionInfo {
+protected:
   unsigned TypeInfoArgNr;
 
 public:
@@ -170,16 +233,25 @@ public:
   }
 };
 
+namespace InitKind {
+enum Type {
+  None,   /// The memory is left uninitialized.
+  Zero,   /// The memory is zero-initialized.
+  Default /// The elements are set to the default initializer of their type.
+};
+}
+
 class ArrayFI : public TypeInfoFI {
   int ArrSizeArgNr;
-  bool Initialized;
+  InitKind::Type Init;
   Value *arrSize;
+  Value *InitByte;
 
 public:
   ArrayFI(ReturnType::Type returnType, unsigned tiArgNr, unsigned arrSizeArgNr,
-          bool initialized)
+          InitKind::Type init)
       : TypeInfoFI(returnType, tiArgNr), ArrSizeArgNr(arrSizeArgNr),
-        Initialized(initialized) {}
+        Init(init) {}
 
   bool analyze(CallSite CS, const Analysis &A) override {
     if (!TypeInfoFI::analyze(CS, A)) {
@@ -195,15 +267,39 @@ public:
     const PointerType *PtrTy = cast<PointerType>(ArrTy->getElementType(1));
     Ty = PtrTy->getElementType();
 
+    // The stack memory is initialized using memset, so only initializers
+    // consisting of a repeated byte (e.g. 0xFF for chars) are supported.
+    InitByte = nullptr;
+    if (Init == InitKind::Zero) {
+      InitByte = ConstantInt::get(Type::getInt8Ty(A.M.getContext()), 0);
+    } else if (Init == InitKind::Default) {
+      Constant *ElemInit = A.getElemInitFor(CS.getArgument(TypeInfoArgNr));
+      if (ElemInit && ElemInit->getType() == Ty) {
+        InitByte = isBytewiseValue(ElemInit);
+      }
+      if (!InitByte) {
+        return false;
+      }
+    }
+
     // If the user explicitly disabled the limits, don't even check
     // whether the element count fits in 32 bits. This could cause
     // miscompilations for humongous arrays, but as the value "range"
     // (set bits) inference algorithm is rather limited, this is
     // useful for experimenting.
+    NeedsSizeCheck = false;
     if (SizeLimit > 0) {
       uint64_t ElemSize = A.DL.getTypeAllocSize(Ty);
       if (!isKnownLessThan(arrSize, SizeLimit / ElemSize, A)) {
-        return false;
+        // Otherwise, the array can still be put on the stack if it turns
+        // out to be small enough at runtime.
+        if (isa<Constant>(arrSize) || !CS.isCall() ||
+            SizeLimit / ElemSize < 2) {
+          return false;
+        }
+        NeedsSizeCheck = true;
+        Count = arrSize;
+        CountLimit = SizeLimit / ElemSize;
       }
     }
 
@@ -232,26 +328,30 @@ public:
     AllocaInst *alloca =
         Builder.CreateAlloca(Ty, count, ".nongc_mem"); // FIXME: align?
 
-    if (Initialized) {
-      // For now, only zero-init is supported.
-      uint64_t size = A.DL.getTypeStoreSize(Ty);
+    // Use the original B to put initialization at the allocation site.
+    return finishStackMemory(CS, B, alloca, A);
+  }
+
+protected:
+  Value *finishStackMemory(CallSite CS, IRBuilder<> &B, Value *Mem,
+                           const Analysis &A) override {
+    if (InitByte) {
+      uint64_t size = A.DL.getTypeAllocSize(Ty);
       Value *TypeSize = ConstantInt::get(arrSize->getType(), size);
-      // Use the original B to put initialization at the
-      // allocation site.
       Value *Size = B.CreateMul(TypeSize, arrSize);
-      EmitMemZero(B, alloca, Size, A);
+      EmitMemSet(B, Mem, InitByte, Size, A);
     }
 
     if (ReturnType == ReturnType::Array) {
       Value *arrStruct = llvm::UndefValue::get(CS.getType());
-      arrStruct = Builder.CreateInsertValue(arrStruct, arrSize, 0);
+      arrStruct = B.CreateInsertValue(arrStruct, arrSize, 0);
       Value *memPtr =
-          Builder.CreateBitCast(alloca, PointerType::getUnqual(B.getInt8Ty()));
-      arrStruct = Builder.CreateInsertValue(arrStruct, memPtr, 1);
+          B.CreateBitCast(Mem, PointerType::getUnqual(B.getInt8Ty()));
+      arrStruct = B.CreateInsertValue(arrStruct, memPtr, 1);
       return arrStruct;
     }
 
-    return alloca;
+    return Mem;
   }
 };
 
@@ -336,19 +436,26 @@ public:
 
     SizeArg = CS.getArgument(SizeArgNr);
 
+    // Should be i8.
+    Ty = CS.getType()->getContainedType(0);
+
     // If the user explicitly disabled the limits, don't even check
     // whether the allocated size fits in 32 bits. This could cause
     // miscompilations for humongous allocations, but as the value
     // "range" (set bits) inference algorithm is rather limited, this
     // is useful for experimenting.
+    NeedsSizeCheck = false;
     if (SizeLimit > 0) {
       if (!isKnownLessThan(SizeArg, SizeLimit, A)) {
-        return false;
+        if (isa<Constant>(SizeArg) || !CS.isCall()) {
+          return false;
+        }
+        NeedsSizeCheck = true;
+        Count = SizeArg;
+        CountLimit = SizeLimit;
       }
     }
 
-    // Should be i8.
-    Ty = CS.getType()->getContainedType(0);
     return true;
   }
 
@@ -396,6 +503,7 @@ class LLVM_LIBRARY_VISIBILITY GarbageCollect2Stack : public FunctionPass {
   TypeInfoFI AllocMemoryT;
   ArrayFI NewArrayU;
   ArrayFI NewArrayT;
+  ArrayFI NewArrayIT;
   AllocClassFI AllocClass;
   UntypedMemoryFI AllocMemory;
 
@@ -431,11 +539,13 @@ FunctionPass *createGarbageCollect2Stack() {
 
 GarbageCollect2Stack::GarbageCollect2Stack()
     : FunctionPass(ID), AllocMemoryT(ReturnType::Pointer, 0),
-      NewArrayU(ReturnType::Array, 0, 1, false),
-      NewArrayT(ReturnType::Array, 0, 1, true), AllocMemory(0) {
+      NewArrayU(ReturnType::Array, 0, 1, InitKind::None),
+      NewArrayT(ReturnType::Array, 0, 1, InitKind::Zero),
+      NewArrayIT(ReturnType::Array, 0, 1, InitKind::Default), AllocMemory(0) {
   KnownFunctions["_d_allocmemoryT"] = &AllocMemoryT;
   KnownFunctions["_d_newarrayU"] = &NewArrayU;
   KnownFunctions["_d_newarrayT"] = &NewArrayT;
+  KnownFunctions["_d_newarrayiT"] = &NewArrayIT;
   KnownFunctions["_d_allocclass"] = &AllocClass;
   KnownFunctions["_d_allocmemory"] = &AllocMemory;
 }
@@ -491,6 +601,10 @@ bool GarbageCollect2Stack::runOnFunction(Function &F) {
 
   IRBuilder<> AllocaBuilder(&Entry, Entry.begin());
 
+  // Allocations which are only promoted if small enough at runtime. These
+  // change the CFG, so they are handled after all others.
+  SmallVector<std::pair<CallInst *, FunctionInfo *>, 4> SizeChecked;
+
   bool Changed = false;
   for (auto &BB : F) {
     for (auto I = BB.begin(), E = BB.end(); I != E;) {
@@ -551,6 +665,11 @@ bool GarbageCollect2Stack::runOnFunction(Function &F) {
         i->setTailCall(false);
       }
 
+      if (info->NeedsSizeCheck) {
+        SizeChecked.push_back(std::make_pair(cast<CallInst>(Inst), info));
+        continue;
+      }
+
       IRBuilder<> Builder(&BB, originalI);
       Value *newVal = info->promote(CS, Builder, A);
 
@@ -567,10 +686,18 @@ bool GarbageCollect2Stack::runOnFunction(Function &F) {
     }
   }
 
+  for (auto &P : SizeChecked) {
+    // The FunctionInfo state is per call, so redo the analysis.
+    bool Promotable = P.second->analyze(P.first, A);
+    assert(Promotable && P.second->NeedsSizeCheck);
+    (void)Promotable;
+    P.second->promoteSizeChecked(P.first, A);
+  }
+
   return Changed;
 }
 
-Type *Analysis::getTypeFor(Value *typeinfo) const {
+MDNode *Analysis::getTypeMetadata(Value *typeinfo) const {
   GlobalVariable *ti_global =
       dyn_cast<GlobalVariable>(typeinfo->stripPointerCasts());
   if (!ti_global) {
@@ -595,8 +722,8 @@ Type *Analysis::getTypeFor(Value *typeinfo) const {
   }
 
 #if LDC_LLVM_VER >= 306
-  Value *ti = llvm::MetadataAsValue::get(node->getContext(),
-                                         node->getOperand(TD_TypeInfo));
+  Value *ti = mdconst::dyn_extract_or_null<Constant>(
+      node->getOperand(TD_TypeInfo));
 #else
   Value *ti = node->getOperand(TD_TypeInfo);
 #endif
@@ -604,15 +731,35 @@ Type *Analysis::getTypeFor(Value *typeinfo) const {
     return nullptr;
   }
 
+  return node;
+}
+
+Type *Analysis::getTypeFor(Value *typeinfo) const {
+  MDNode *node = getTypeMetadata(typeinfo);
+  if (!node) {
+    return nullptr;
+  }
+
 #if LDC_LLVM_VER >= 306
-  return llvm::MetadataAsValue::get(node->getContext(),
-                                    node->getOperand(TD_Type))
-      ->getType();
+  return mdconst::extract<Constant>(node->getOperand(TD_Type))->getType();
 #else
   return node->getOperand(TD_Type)->getType();
 #endif
 }
 
+Constant *Analysis::getElemInitFor(Value *typeinfo) const {
+  MDNode *node = getTypeMetadata(typeinfo);
+  if (!node) {
+    return nullptr;
+  }
+
+#if LDC_LLVM_VER >= 306
+  return mdconst::dyn_extract_or_null<Constant>(node->getOperand(TD_ElemInit));
+#else
+  return dyn_cast_or_null<Constant>(node->getOperand(TD_ElemInit));
+#endif
+}
+
 /// Returns whether Def is used by any instruction that is reachable from Alloc
 /// (without executing Def again).
 static bool mayBeUsedAfterRealloc(Instruction *Def, BasicBlock::iterator Alloc,
@@ -889,6 +1036,16 @@ bool isSafeToStackAllocate(BasicBlock::iterator Alloc, Value *V, DominatorTree &
       }
       // Storing to the pointee does not cause the pointer to be captured.
       break;
+    case Instruction::ExtractValue:
+      // Only pointers or aggregates extracted from an aggregate containing the
+      // pointer can carry it; integer fields (e.g. array lengths) cannot.
+      if (!I->getType()->isPointerTy() && !I->getType()->isAggregateType()) {
+        break;
+      }
+    // fall through
+    case Instruction::InsertValue:
+    // Closure frames end up as the context pointer of a delegate, i.e. inserted
+    // into a { i8*, fptr } pair; follow the aggregate like a derived pointer.
     case Instruction::BitCast:
     case Instruction::GetElementPtr:
     case Instruction::PHI:
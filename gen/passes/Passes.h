@@ -25,6 +25,9 @@ llvm::FunctionPass *createSimplifyDRuntimeCalls();
 
 llvm::FunctionPass *createGarbageCollect2Stack();
 
+// Removes redundant array bounds checks and hoists them out of loops.
+llvm::FunctionPass *createBoundsCheckElimination();
+
 llvm::ModulePass *createStripExternalsPass();
 
 #endif
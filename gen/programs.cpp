@@ -30,8 +30,9 @@ static std::string findProgramByName(const std::string &name) {
 #endif
 }
 
-static std::string getProgram(const char *name, const cl::opt<std::string> *opt,
-                              const char *envVar = nullptr) {
+static std::string findProgram(const char *name,
+                               const cl::opt<std::string> *opt,
+                               const char *envVar = nullptr) {
   std::string path;
   const char *prog = nullptr;
 
@@ -48,6 +49,13 @@ static std::string getProgram(const char *name, const cl::opt<std::string> *opt,
     path = findProgramByName(name);
   }
 
+  return path;
+}
+
+static std::string getProgram(const char *name, const cl::opt<std::string> *opt,
+                              const char *envVar = nullptr) {
+  std::string path = findProgram(name, opt, envVar);
+
   if (path.empty()) {
     error(Loc(), "failed to locate %s", name);
     fatal();
@@ -60,13 +68,15 @@ std::string getProgram(const char *name, const char *envVar) {
   return getProgram(name, nullptr, envVar);
 }
 
-std::string getGcc() {
 #if defined(__FreeBSD__) && __FreeBSD__ >= 10
-  // Default compiler on FreeBSD 10 is clang
-  return getProgram("clang", &gcc, "CC");
+// Default compiler on FreeBSD 10 is clang
+static const char *const gccName = "clang";
 #else
-  return getProgram("gcc", &gcc, "CC");
+static const char *const gccName = "gcc";
 #endif
-}
+
+std::string getGcc() { return getProgram(gccName, &gcc, "CC"); }
+
+bool isGccAvailable() { return !findProgram(gccName, &gcc, "CC").empty(); }
 
 std::string getArchiver() { return getProgram("ar", &ar); }
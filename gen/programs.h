@@ -19,6 +19,8 @@
 std::string getProgram(const char *name, const char *envVar = nullptr);
 
 std::string getGcc();
+/// Returns whether getGcc() would find a program (without failing if not).
+bool isGccAvailable();
 std::string getArchiver();
 
 #endif
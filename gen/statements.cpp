@@ -26,10 +26,13 @@
 #include "gen/tollvm.h"
 #include "ir/irfunction.h"
 #include "ir/irmodule.h"
+#include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/IR/CFG.h"
 #include "llvm/IR/InlineAsm.h"
 #include <fstream>
+#include <map>
 #include <math.h>
+#include <set>
 #include <stdio.h>
 
 // Need to include this after the other DMD includes because of missing
@@ -82,6 +85,194 @@ static LLValue *call_string_switch_runtime(llvm::Value *table, Expression *e) {
   return call.getInstruction();
 }
 
+namespace {
+/// Emits the dispatch of a string switch inline, computing the index of the
+/// matching case (or -1, like the _d_switch_* druntime functions) without a
+/// runtime call. The cases are first distinguished by length, then by the
+/// character at the position splitting the remaining candidates into the most
+/// groups, until only one candidate is left, which is finally verified with a
+/// single memcmp.
+class StringSwitchDispatch {
+public:
+  StringSwitchDispatch(IRState *irs, unsigned elemSize)
+      : irs(irs), elemSize(elemSize),
+        elemTy(LLIntegerType::get(irs->context(), elemSize * 8)) {}
+
+  // A case string, its sorted index and the pointer to its constant data.
+  struct Case {
+    StringExp *str;
+    unsigned index;
+    LLConstant *ptr;
+  };
+
+  /// Returns whether the given case expressions are all string literals of
+  /// the condition's character type, i.e. whether the dispatch can be
+  /// emitted inline.
+  static bool canDispatch(CaseStatements *cases, unsigned elemSize) {
+    for (auto cs : *cases) {
+      StringExp *se = cs->exp->toStringExp();
+      if (!se || se->sz != elemSize) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  LLValue *emit(Expression *condition, const std::vector<Case> &cases) {
+    DValue *val = toElemDtor(condition);
+    LLValue *len = DtoArrayLen(val);
+    condPtr = DtoBitCast(DtoArrayPtr(val), getPtrToType(elemTy));
+
+    endbb = irs->insertBB("stringswitch.end");
+    phi = llvm::PHINode::Create(LLType::getInt32Ty(irs->context()),
+                                cases.size() + 1, "stringswitch.index", endbb);
+
+    std::map<size_t, std::vector<Case>> byLength;
+    for (const auto &c : cases) {
+      byLength[c.str->len].push_back(c);
+    }
+
+    llvm::SwitchInst *si = llvm::SwitchInst::Create(len, endbb, byLength.size(),
+                                                    irs->scopebb());
+    phi->addIncoming(noMatch(), irs->scopebb());
+    for (const auto &group : byLength) {
+      llvm::BasicBlock *bb = irs->insertBBBefore(endbb, "stringswitch.len");
+      si->addCase(isaConstantInt(DtoConstSize_t(group.first)), bb);
+      irs->scope() = IRScope(bb);
+      emitTree(group.second, group.first);
+    }
+
+    irs->scope() = IRScope(endbb);
+    return phi;
+  }
+
+private:
+  IRState *irs;
+  const unsigned elemSize;
+  LLType *const elemTy;
+  LLValue *condPtr = nullptr;
+  llvm::BasicBlock *endbb = nullptr;
+  llvm::PHINode *phi = nullptr;
+
+  LLConstant *noMatch() {
+    return LLConstantInt::get(LLType::getInt32Ty(irs->context()), -1, true);
+  }
+
+  // Emits the dispatch among candidates of equal length len into the current
+  // block.
+  void emitTree(const std::vector<Case> &candidates, size_t len) {
+    if (candidates.size() == 1) {
+      const Case &c = candidates[0];
+      LLValue *index = DtoConstUint(c.index);
+      if (len != 0) {
+        LLValue *cmp =
+            DtoMemCmp(condPtr, c.ptr, DtoConstSize_t(len * elemSize));
+        LLValue *isEqual = irs->ir->CreateICmpEQ(cmp, DtoConstInt(0));
+        index = irs->ir->CreateSelect(isEqual, index, noMatch());
+      }
+      phi->addIncoming(index, irs->scopebb());
+      irs->ir->CreateBr(endbb);
+      return;
+    }
+
+    // Find the position with the most distinct characters. There is at least
+    // one with two, as the case strings are distinct.
+    size_t bestPos = 0;
+    size_t bestCount = 0;
+    for (size_t pos = 0; pos < len; ++pos) {
+      std::set<unsigned> chars;
+      for (const auto &c : candidates) {
+        chars.insert(c.str->charAt(pos));
+      }
+      if (chars.size() > bestCount) {
+        bestPos = pos;
+        bestCount = chars.size();
+      }
+    }
+    assert(bestCount > 1 && "duplicate case strings");
+
+    std::map<unsigned, std::vector<Case>> byChar;
+    for (const auto &c : candidates) {
+      byChar[c.str->charAt(bestPos)].push_back(c);
+    }
+
+    LLValue *chr = DtoLoad(DtoGEPi1(condPtr, bestPos));
+    llvm::SwitchInst *si =
+        llvm::SwitchInst::Create(chr, endbb, byChar.size(), irs->scopebb());
+    phi->addIncoming(noMatch(), irs->scopebb());
+    for (const auto &group : byChar) {
+      llvm::BasicBlock *bb = irs->insertBBBefore(endbb, "stringswitch.char");
+      si->addCase(LLConstantInt::get(llvm::cast<LLIntegerType>(elemTy),
+                                     group.first),
+                  bb);
+      irs->scope() = IRScope(bb);
+      emitTree(group.second, len);
+    }
+  }
+};
+}
+
+/// Marks the loop of a frontend-generated array operation (with the given
+/// header, body entry and backedge) for vectorization. The D spec requires
+/// array operation operands not to overlap, so the memory accesses have no
+/// loop-carried dependencies and the vectorizer can omit runtime alias checks.
+static void addArrayOpLoopMetadata(llvm::BasicBlock *headerbb,
+                                   llvm::BasicBlock *bodybb,
+                                   llvm::BasicBlock *exitbb,
+                                   llvm::BranchInst *backedge) {
+  llvm::LLVMContext &ctx = gIR->context();
+
+#if LDC_LLVM_VER >= 306
+  llvm::Metadata *enableArgs[] = {
+      llvm::MDString::get(ctx, "llvm.loop.vectorize.enable"),
+      llvm::ConstantAsMetadata::get(DtoConstBool(true))};
+  llvm::Metadata *loopArgs[] = {nullptr, llvm::MDNode::get(ctx, enableArgs)};
+  llvm::MDNode *loopID = llvm::MDNode::getDistinct(ctx, loopArgs);
+  loopID->replaceOperandWith(0, loopID);
+#else
+  llvm::Value *enableArgs[] = {
+      llvm::MDString::get(ctx, "llvm.loop.vectorize.enable"),
+      DtoConstBool(true)};
+  llvm::MDNode *tempNode = llvm::MDNode::getTemporary(ctx, llvm::None);
+  llvm::Value *loopArgs[] = {tempNode, llvm::MDNode::get(ctx, enableArgs)};
+  llvm::MDNode *loopID = llvm::MDNode::get(ctx, loopArgs);
+  loopID->replaceOperandWith(0, loopID);
+  llvm::MDNode::deleteTemporary(tempNode);
+#endif
+
+  backedge->setMetadata("llvm.loop", loopID);
+
+  // Tag all accesses to the array elements (i.e. not to local variables like
+  // the loop counter) in the loop body.
+  llvm::SmallPtrSet<llvm::BasicBlock *, 16> visited;
+  llvm::SmallVector<llvm::BasicBlock *, 16> worklist;
+  visited.insert(headerbb);
+  visited.insert(exitbb);
+  worklist.push_back(bodybb);
+  while (!worklist.empty()) {
+    llvm::BasicBlock *bb = worklist.pop_back_val();
+    if (visited.count(bb)) {
+      continue;
+    }
+    visited.insert(bb);
+    for (auto &inst : *bb) {
+      llvm::Value *ptr = nullptr;
+      if (auto load = llvm::dyn_cast<llvm::LoadInst>(&inst)) {
+        ptr = load->getPointerOperand();
+      } else if (auto store = llvm::dyn_cast<llvm::StoreInst>(&inst)) {
+        ptr = store->getPointerOperand();
+      }
+      if (ptr && !llvm::isa<llvm::AllocaInst>(ptr->stripPointerCasts())) {
+        inst.setMetadata("llvm.mem.parallel_loop_access", loopID);
+      }
+    }
+    for (auto it = llvm::succ_begin(bb), end = llvm::succ_end(bb); it != end;
+         ++it) {
+      worklist.push_back(*it);
+    }
+  }
+}
+
 //////////////////////////////////////////////////////////////////////////////
 
 class ToIRVisitor : public Visitor {
@@ -868,8 +1059,11 @@ public:
     indices.reserve(caseCount);
     bool useSwitchInst = true;
 
-    // For string switches, sort the cases and emit the table data.
+    // For string switches, sort the cases and either prepare the inline
+    // dispatch or emit the table data for the runtime.
     llvm::Value *stringTableSlice = nullptr;
+    unsigned stringElemSize = 0;
+    std::vector<StringSwitchDispatch::Case> stringCases;
     const bool isStringSwitch = !stmt->condition->type->isintegral();
     if (isStringSwitch) {
       Logger::println("is string switch");
@@ -886,19 +1080,29 @@ public:
         indices.push_back(DtoConstUint(i));
       }
 
-      // Create internal global with the data table.
-      const auto elemTy = DtoType(stmt->condition->type);
-      const auto arrTy = llvm::ArrayType::get(elemTy, stringConsts.size());
-      const auto arrInit = LLConstantArray::get(arrTy, stringConsts);
-      const auto arr = new llvm::GlobalVariable(
-          irs->module, arrTy, true, llvm::GlobalValue::InternalLinkage, arrInit,
-          ".string_switch_table_data");
-
-      // Create D slice to pass to runtime later.
-      const auto arrPtr =
-          llvm::ConstantExpr::getBitCast(arr, getPtrToType(elemTy));
-      const auto arrLen = DtoConstSize_t(stringConsts.size());
-      stringTableSlice = DtoConstSlice(arrLen, arrPtr);
+      stringElemSize = static_cast<unsigned>(
+          stmt->condition->type->toBasetype()->nextOf()->size());
+      if (StringSwitchDispatch::canDispatch(cases, stringElemSize)) {
+        for (size_t i = 0; i < caseCount; ++i) {
+          stringCases.push_back({(*cases)[i]->exp->toStringExp(),
+                                 static_cast<unsigned>(i),
+                                 stringConsts[i]->getAggregateElement(1u)});
+        }
+      } else {
+        // Create internal global with the data table.
+        const auto elemTy = DtoType(stmt->condition->type);
+        const auto arrTy = llvm::ArrayType::get(elemTy, stringConsts.size());
+        const auto arrInit = LLConstantArray::get(arrTy, stringConsts);
+        const auto arr = new llvm::GlobalVariable(
+            irs->module, arrTy, true, llvm::GlobalValue::InternalLinkage,
+            arrInit, ".string_switch_table_data");
+
+        // Create D slice to pass to runtime later.
+        const auto arrPtr =
+            llvm::ConstantExpr::getBitCast(arr, getPtrToType(elemTy));
+        const auto arrLen = DtoConstSize_t(stringConsts.size());
+        stringTableSlice = DtoConstSlice(arrLen, arrPtr);
+      }
     } else {
       for (auto cs : *cases) {
         if (cs->exp->op == TOKvar) {
@@ -944,7 +1148,10 @@ public:
     if (useSwitchInst) {
       // The case index value.
       LLValue *condVal;
-      if (isStringSwitch) {
+      if (isStringSwitch && !stringTableSlice) {
+        condVal = StringSwitchDispatch(irs, stringElemSize)
+                      .emit(stmt->condition, stringCases);
+      } else if (isStringSwitch) {
         condVal = call_string_switch_runtime(stringTableSlice, stmt->condition);
       } else {
         condVal = DtoRVal(toElemDtor(stmt->condition));
@@ -1442,7 +1649,11 @@ public:
     }
 
     // jump to condition
-    llvm::BranchInst::Create(condbb, irs->scopebb());
+    auto backedge = llvm::BranchInst::Create(condbb, irs->scopebb());
+
+    if (irs->func()->decl->isArrayOp) {
+      addArrayOpLoopMetadata(condbb, bodybb, endbb, backedge);
+    }
 
     // end the dwarf lexical block
     irs->DBuilder.EmitBlockEnd();
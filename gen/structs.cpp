@@ -70,6 +70,53 @@ void DtoResolveStruct(StructDeclaration *sd, Loc &callerLoc) {
 ///////////////////////////////////////
 ////////////////////////////////////////////////////////////////////////////////
 
+/// Maximum number of scalar fields compared one by one in DtoStructEquals;
+/// larger structs are compared using a single memcmp.
+static const unsigned maxFieldwiseCompares = 8;
+
+/// Returns whether the struct only contains (possibly nested) non-overlapping
+/// integral and pointer fields, and counts them.
+static bool isFieldwiseComparable(StructDeclaration *sd, unsigned &numFields) {
+  for (auto vd : sd->fields) {
+    if (vd->overlapped) {
+      return false;
+    }
+    Type *t = vd->type->toBasetype();
+    if (t->ty == Tstruct) {
+      if (!isFieldwiseComparable(static_cast<TypeStruct *>(t)->sym,
+                                 numFields)) {
+        return false;
+      }
+    } else if ((t->isintegral() && t->ty != Tvector) || t->ty == Tpointer) {
+      if (++numFields > maxFieldwiseCompares) {
+        return false;
+      }
+    } else {
+      return false;
+    }
+  }
+  return true;
+}
+
+/// Compares all scalar fields of two struct lvalues, ignoring any padding, and
+/// ANDs the results into `res` (i1).
+static LLValue *DtoFieldwiseEquals(StructDeclaration *sd, LLValue *lhs,
+                                   LLValue *rhs, LLValue *res) {
+  for (auto vd : sd->fields) {
+    LLValue *lfield = DtoIndexAggregate(lhs, sd, vd);
+    LLValue *rfield = DtoIndexAggregate(rhs, sd, vd);
+    Type *t = vd->type->toBasetype();
+    if (t->ty == Tstruct) {
+      res = DtoFieldwiseEquals(static_cast<TypeStruct *>(t)->sym, lfield,
+                               rfield, res);
+    } else {
+      LLValue *eq = gIR->ir->CreateICmpEQ(DtoLoad(lfield), DtoLoad(rfield));
+      res = res ? gIR->ir->CreateAnd(res, eq) : eq;
+    }
+  }
+  return res;
+}
+
 LLValue *DtoStructEquals(TOK op, DValue *lhs, DValue *rhs) {
   Type *t = lhs->type->toBasetype();
   assert(t->ty == Tstruct);
@@ -87,6 +134,21 @@ LLValue *DtoStructEquals(TOK op, DValue *lhs, DValue *rhs) {
     return DtoConstBool(cmpop == llvm::ICmpInst::ICMP_EQ);
   }
 
+  // Structs made of a few scalar fields are compared member by member (this
+  // skips any padding and lets LLVM combine the loads); identity keeps the
+  // bitwise semantics.
+  StructDeclaration *sd = static_cast<TypeStruct *>(t)->sym;
+  unsigned numFields = 0;
+  if ((op == TOKequal || op == TOKnotequal) &&
+      isFieldwiseComparable(sd, numFields)) {
+    LLValue *res = DtoFieldwiseEquals(sd, DtoLVal(lhs), DtoLVal(rhs), nullptr);
+    if (!res) {
+      // only empty nested structs
+      return DtoConstBool(cmpop == llvm::ICmpInst::ICMP_EQ);
+    }
+    return cmpop == llvm::ICmpInst::ICMP_EQ ? res : gIR->ir->CreateNot(res);
+  }
+
   // call memcmp
   size_t sz = getTypeAllocSize(DtoType(t));
   LLValue *val = DtoMemCmp(DtoLVal(lhs), DtoLVal(rhs), DtoConstSize_t(sz));
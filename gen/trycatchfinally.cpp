@@ -17,6 +17,13 @@
 #include "gen/runtime.h"
 #include "gen/tollvm.h"
 #include "ir/irfunction.h"
+#include "llvm/Support/CommandLine.h"
+
+static llvm::cl::opt<bool> disableLandingPadSharing(
+    "disable-landing-pad-sharing",
+    llvm::cl::desc("Emit a separate landing pad dispatch for every cleanup "
+                   "scope instead of chaining into the enclosing scope's one"),
+    llvm::cl::ZeroOrMore);
 
 ////////////////////////////////////////////////////////////////////////////////
 
@@ -593,7 +600,7 @@ void TryCatchFinallyScopes::tryResolveGotos(Identifier *labelName,
 llvm::BasicBlock *TryCatchFinallyScopes::getLandingPad() {
   llvm::BasicBlock *&landingPad = getLandingPadRef(currentCleanupScope());
   if (!landingPad)
-    landingPad = emitLandingPad();
+    landingPad = emitLandingPad(currentCleanupScope());
   return landingPad;
 }
 
@@ -630,14 +637,29 @@ llvm::LandingPadInst *createLandingPadInst(IRState &irs) {
 }
 }
 
-llvm::BasicBlock *TryCatchFinallyScopes::emitLandingPad() {
+llvm::BasicBlock *TryCatchFinallyScopes::emitLandingPad(CleanupCursor scope) {
 #if LDC_LLVM_VER >= 308
   if (useMSVCEH()) {
-    assert(currentCleanupScope() > 0);
-    return emitLandingPadMSVC(currentCleanupScope() - 1);
+    assert(scope > 0);
+    return emitLandingPadMSVC(scope - 1);
   }
 #endif
 
+  // If there is no try-catch scope in between, the landing pad for a nested
+  // cleanup scope only differs from the enclosing scope's one by the innermost
+  // cleanup. So just run that one and continue with the enclosing landing
+  // pad's dispatch code (similar to the chained cleanup pads for MSVC) instead
+  // of adding yet another path through all the cleanups and catches.
+  llvm::BasicBlock *parentDispatchBB = nullptr;
+  const CleanupCursor innermostTryCatch =
+      tryCatchScopes.empty() ? 0 : tryCatchScopes.back().getCleanupScope();
+  if (!disableLandingPadSharing && scope > innermostTryCatch + 1) {
+    llvm::BasicBlock *&parentPad = getLandingPadRef(scope - 1);
+    if (!parentPad)
+      parentPad = emitLandingPad(scope - 1);
+    parentDispatchBB = parentPad->getTerminator()->getSuccessor(0);
+  }
+
   // save and rewrite scope
   IRScope savedIRScope = irs.scope();
 
@@ -658,9 +680,29 @@ llvm::BasicBlock *TryCatchFinallyScopes::emitLandingPad() {
     ehSelectorSlot = DtoRawAlloca(ehSelector->getType(), 0, "eh.selector");
   irs.ir->CreateStore(ehSelector, ehSelectorSlot);
 
+  llvm::BasicBlock *dispatchBB =
+      irs.insertBB(beginBB->getName() + llvm::Twine(".dispatch"));
+  irs.ir->CreateBr(dispatchBB);
+  irs.scope() = IRScope(dispatchBB);
+
+  if (parentDispatchBB) {
+    // The clauses are the same as for the parent landing pad, as there are no
+    // catches in between.
+    for (auto it = tryCatchScopes.rbegin(), end = tryCatchScopes.rend();
+         it != end; ++it) {
+      for (const auto &cb : it->getCatchBlocks())
+        landingPad->addClause(cb.classInfoPtr);
+    }
+    landingPad->setCleanup(true);
+    runCleanups(scope, scope - 1, parentDispatchBB);
+
+    irs.scope() = savedIRScope;
+    return beginBB;
+  }
+
   // Add landingpad clauses, emit finallys and 'if' chain to catch the
   // exception.
-  CleanupCursor lastCleanup = currentCleanupScope();
+  CleanupCursor lastCleanup = scope;
   for (auto it = tryCatchScopes.rbegin(), end = tryCatchScopes.rend();
        it != end; ++it) {
     const auto &tryCatchScope = *it;
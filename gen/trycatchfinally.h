@@ -277,8 +277,14 @@ private:
 
   llvm::BasicBlock *&getLandingPadRef(CleanupCursor scope);
 
-  /// Emits a landing pad to honor all the active cleanups and catches.
-  llvm::BasicBlock *emitLandingPad();
+  /// Emits a landing pad to honor all the active catches and the cleanups up
+  /// to the given scope.
+  ///
+  /// The landing pad block only contains the landingpad instruction itself and
+  /// branches to a separate dispatch block running the cleanups and catches,
+  /// so that the latter can be shared with the landing pads of nested cleanup
+  /// scopes.
+  llvm::BasicBlock *emitLandingPad(CleanupCursor scope);
 
   /// Internal version that allows specifying the scope at which to start
   /// emitting the cleanups.
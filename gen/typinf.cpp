@@ -198,16 +198,30 @@ static void emitTypeMetadata(TypeInfoDeclaration *tid) {
     llvm::NamedMDNode *meta = gIR->module.getNamedMetadata(metaname);
 
     if (!meta) {
+      // Arrays of e.g. chars are allocated by _d_newarrayiT, which needs to
+      // know the element initializer to be promoted to the stack.
+      llvm::Constant *elemInit = nullptr;
+      if (t->ty == Tarray) {
+        Type *elemType = t->nextOf()->toBasetype();
+        if (elemType->isTypeBasic() && !elemType->isZeroInit()) {
+          elemInit = DtoConstExpInit(tid->loc, elemType,
+                                     elemType->defaultInit(tid->loc));
+        }
+      }
+
 // Construct the fields
 #if LDC_LLVM_VER >= 306
       llvm::Metadata *mdVals[TD_NumFields];
       mdVals[TD_TypeInfo] = llvm::ValueAsMetadata::get(getIrGlobal(tid)->value);
       mdVals[TD_Type] = llvm::ConstantAsMetadata::get(
           llvm::UndefValue::get(DtoType(tid->tinfo)));
+      mdVals[TD_ElemInit] =
+          elemInit ? llvm::ConstantAsMetadata::get(elemInit) : nullptr;
 #else
       MDNodeField *mdVals[TD_NumFields];
       mdVals[TD_TypeInfo] = llvm::cast<MDNodeField>(getIrGlobal(tid)->value);
       mdVals[TD_Type] = llvm::UndefValue::get(DtoType(tid->tinfo));
+      mdVals[TD_ElemInit] = elemInit;
 #endif
 
       // Construct the metadata and insert it into the module.